@@ -0,0 +1,319 @@
+#pragma once
+
+// Baseline comparison: loads the cases of an earlier --output json run, matches them to
+// this run by id and tests each pair of sample sets with the Mann-Whitney U test. A case
+// that is significantly slower by more than the threshold counts as a regression. The
+// ids do not encode size, iterations, thresholds or timer, so a baseline recorded with
+// different settings is refused rather than diffed.
+
+#include <algorithm>
+#include <stdexcept>
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <map>
+#include "results.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////// JSON reader
+
+// Just enough JSON to read back what to_json() writes
+struct json_node {
+    enum class kind { null, boolean, number, string, array, object };
+
+    kind                                           type   = kind::null;
+    double                                         number = 0;
+    std::string                                    text;
+    std::vector<json_node>                         items;
+    std::vector<std::pair<std::string, json_node>> fields;
+
+    const json_node* get(std::string_view key) const {
+        for (const auto& [name, value] : fields)
+            if (name == key)
+                return &value;
+        return nullptr;
+    }
+};
+
+class json_parser {
+public:
+    explicit json_parser(std::string_view text) : text_(text) {}
+
+    json_node parse() {
+        auto node = value();
+        skip_space();
+        if (pos_ != text_.size())
+            fail("trailing characters");
+        return node;
+    }
+
+private:
+    [[noreturn]] void fail(std::string_view what) const {
+        throw std::runtime_error(std::format("JSON: {} at offset {}", what, pos_));
+    }
+
+    void skip_space() {
+        while (pos_ < text_.size() && std::string_view(" \t\r\n").find(text_[pos_]) != std::string_view::npos)
+            pos_++;
+    }
+
+    bool consume(char c) {
+        skip_space();
+        if (pos_ < text_.size() && text_[pos_] == c) {
+            pos_++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (!consume(c))
+            fail(std::format("expected '{}'", c));
+    }
+
+    bool literal(std::string_view word) {
+        if (text_.substr(pos_, word.size()) != word)
+            return false;
+        pos_ += word.size();
+        return true;
+    }
+
+    json_node value() {
+        skip_space();
+        if (pos_ >= text_.size())
+            fail("unexpected end");
+        json_node node;
+        const char c = text_[pos_];
+        if (c == '{') {
+            node.type = json_node::kind::object;
+            pos_++;
+            if (consume('}'))
+                return node;
+            do {
+                skip_space();
+                auto key = string();
+                expect(':');
+                node.fields.emplace_back(std::move(key), value());
+            } while (consume(','));
+            expect('}');
+        }
+        else if (c == '[') {
+            node.type = json_node::kind::array;
+            pos_++;
+            if (consume(']'))
+                return node;
+            do {
+                node.items.push_back(value());
+            } while (consume(','));
+            expect(']');
+        }
+        else if (c == '"') {
+            node.type = json_node::kind::string;
+            node.text = string();
+        }
+        else if (literal("null")) {
+            node.type = json_node::kind::null;
+        }
+        else if (literal("true")) {
+            node.type   = json_node::kind::boolean;
+            node.number = 1;
+        }
+        else if (literal("false")) {
+            node.type = json_node::kind::boolean;
+        }
+        else {
+            node.type = json_node::kind::number;
+            const auto [end, error] = std::from_chars(text_.data() + pos_, text_.data() + text_.size(), node.number);
+            if (error != std::errc())
+                fail("invalid value");
+            pos_ = end - text_.data();
+        }
+        return node;
+    }
+
+    std::string string() {
+        if (pos_ >= text_.size() || text_[pos_] != '"')
+            fail("expected a string");
+        pos_++;
+        std::string out;
+        while (pos_ < text_.size() && text_[pos_] != '"') {
+            char c = text_[pos_++];
+            if (c == '\\' && pos_ < text_.size()) {
+                c = text_[pos_++];
+                switch (c) {
+                    case 'n': out += '\n'; break;
+                    case 't': out += '\t'; break;
+                    case 'r': out += '\r'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'u': // only the control characters json_string() escapes
+                        out += static_cast<char>(std::stoi(std::string(text_.substr(pos_, 4)), nullptr, 16));
+                        pos_ += 4;
+                        break;
+                    default:  out += c;
+                }
+            }
+            else {
+                out += c;
+            }
+        }
+        if (pos_ >= text_.size())
+            fail("unterminated string");
+        pos_++;
+        return out;
+    }
+
+    std::string_view text_;
+    std::size_t      pos_ = 0;
+};
+
+// Settings that change what every case measures; they must match between the runs
+constexpr std::array<const char*, 5> comparable_settings = {"mode", "size", "iter", "thresholds", "timer"};
+
+// A settings value as text, the way parameter_value formats it
+inline std::string json_text(const json_node& node) {
+    return node.type == json_node::kind::number ? std::format("{}", node.number) : node.text;
+}
+
+// Case id -> kept samples (seconds) of a results file written by --output json. Throws
+// if the baseline was recorded with other comparable 'settings' than this run.
+inline std::map<std::string, std::vector<double>> load_baseline(const std::string& path, const parameter_list& settings) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("CANNOT OPEN BASELINE " + zen::quote(path));
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string text = buffer.str();
+    const auto root = json_parser(text).parse();
+
+    if (const auto* recorded = root.get("settings")) {
+        for (const auto* key : comparable_settings) {
+            const auto* theirs = recorded->get(key);
+            const auto  ours   = std::find_if(settings.begin(), settings.end(), [&](const auto& s) { return s.first == key; });
+            if (theirs == nullptr || ours == settings.end() || json_text(*theirs) == ours->second.text)
+                continue;
+            throw std::runtime_error(std::format("BASELINE {} WAS RECORDED WITH {}={}, THIS RUN HAS {}={}",
+                zen::quote(path), key, json_text(*theirs), key, ours->second.text));
+        }
+    }
+
+    const auto* cases = root.get("cases");
+    if (cases == nullptr || cases->type != json_node::kind::array)
+        throw std::runtime_error("BASELINE " + zen::quote(path) + " HAS NO \"cases\" ARRAY");
+
+    std::map<std::string, std::vector<double>> baseline;
+    for (const auto& c : cases->items) {
+        const auto* id      = c.get("id");
+        const auto* samples = c.get("samples");
+        if (id == nullptr || samples == nullptr)
+            continue;
+        auto& values = baseline[id->text];
+        for (const auto& s : samples->items)
+            values.push_back(s.number);
+    }
+    return baseline;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////// Mann-Whitney U
+
+// Two-sided p-value of the Mann-Whitney U test for 'a' and 'b' coming from the same
+// distribution. Small samples without ties use the exact distribution of U (the usual
+// case here: 5-50 repetitions); otherwise the normal approximation with tie and
+// continuity corrections.
+inline double mann_whitney_p(const std::vector<double>& a, const std::vector<double>& b) {
+    const std::size_t m = a.size(), n = b.size();
+    if (m == 0 || n == 0)
+        return 1;
+
+    // Mid-ranks of the pooled samples
+    std::vector<std::pair<double, int>> pooled;
+    for (double x : a) pooled.push_back({x, 0});
+    for (double x : b) pooled.push_back({x, 1});
+    std::sort(pooled.begin(), pooled.end());
+    double rank_sum_a = 0, tie_term = 0;
+    bool ties = false;
+    for (std::size_t i = 0; i < pooled.size(); ) {
+        std::size_t j = i;
+        while (j < pooled.size() && pooled[j].first == pooled[i].first)
+            j++;
+        const double rank = (i + 1 + j) / 2.0;
+        const double t    = static_cast<double>(j - i);
+        ties     |= t > 1;
+        tie_term += t * t * t - t;
+        for (std::size_t k = i; k < j; k++)
+            if (pooled[k].second == 0)
+                rank_sum_a += rank;
+        i = j;
+    }
+    const double u    = rank_sum_a - m * (m + 1) / 2.0;
+    const double mean = m * n / 2.0;
+
+    if (!ties && m * n <= 2500) {
+        // count[i][v]: orderings of i elements of 'a' and j of 'b' with statistic v. The
+        // largest element is either from 'a' (above all j of 'b', adding j) or from 'b'.
+        const std::size_t max_u = m * n;
+        std::vector<std::vector<double>> count(m + 1, std::vector<double>(max_u + 1, 0)), previous;
+        for (std::size_t j = 0; j <= n; j++) {
+            previous = count;
+            for (std::size_t i = 0; i <= m; i++) {
+                for (std::size_t v = 0; v <= max_u; v++) {
+                    if (i == 0 || j == 0) {
+                        count[i][v] = v == 0 ? 1 : 0;
+                        continue;
+                    }
+                    count[i][v] = (v >= j ? count[i - 1][v - j] : 0) + previous[i][v];
+                }
+            }
+        }
+        double total = 0, extreme = 0;
+        for (std::size_t v = 0; v <= max_u; v++) {
+            total += count[m][v];
+            if (std::abs(v - mean) >= std::abs(u - mean) - 1e-9)
+                extreme += count[m][v];
+        }
+        return std::min(1.0, extreme / total);
+    }
+
+    const double variance = m * n / 12.0 * ((m + n + 1) - tie_term / ((m + n) * (m + n - 1.0)));
+    if (variance <= 0)
+        return 1;
+    const double z = (std::abs(u - mean) - 0.5) / std::sqrt(variance);
+    return std::min(1.0, std::erfc(std::max(0.0, z) / std::sqrt(2.0)));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////// Comparison
+
+struct case_change {
+    std::string id;
+    double      baseline = 0; // median seconds
+    double      current  = 0;
+    double      percent  = 0; // (current - baseline) / baseline
+    double      p        = 1;
+    bool        significant = false; // p below alpha
+    bool        regression  = false; // significant and slower by more than the threshold
+};
+
+// Every case of 'results' that the baseline also has, in measurement order
+inline std::vector<case_change> compare_cases(const std::map<std::string, std::vector<double>>& baseline,
+                                              const result_set& results, double threshold_percent, double alpha = 0.05) {
+    std::vector<case_change> changes;
+    for (const auto& r : results.records()) {
+        const auto it = baseline.find(r.id);
+        if (it == baseline.end() || it->second.empty())
+            continue;
+        case_change c;
+        c.id          = r.id;
+        c.baseline    = median_of(it->second);
+        c.current     = r.report.time.median;
+        c.percent     = c.baseline > 0 ? (c.current - c.baseline) / c.baseline * 100 : 0;
+        c.p           = mann_whitney_p(it->second, r.report.time.samples);
+        c.significant = c.p < alpha;
+        c.regression  = c.significant && c.percent > threshold_percent;
+        changes.push_back(std::move(c));
+    }
+    return changes;
+}
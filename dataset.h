@@ -0,0 +1,161 @@
+#pragma once
+
+// Seeded, parallel generation of the test data. The vector is cut into fixed-size
+// chunks and chunk k draws from its own engine, seeded from (seed, k) alone, so the
+// result depends only on the seed and never on how many threads filled it.
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <random>
+#include <span>
+#include "kaizen.h"
+
+constexpr std::size_t dataset_chunk = std::size_t(1) << 16;
+
+// Counter-based stream selection: every (seed, stream) pair gets its own engine
+inline zen::xoshiro256ss stream_engine(std::uint64_t seed, std::uint64_t stream) {
+    std::uint64_t x = seed ^ (stream * 0xd1b54a32d192ed03);
+    return zen::xoshiro256ss(zen::internal::splitmix64(x));
+}
+
+// Thresholds (pregenerated or inline) come from the calling thread's engine; this puts
+// it on a stream of the seed that no data chunk uses
+inline void seed_thresholds(std::uint64_t seed) {
+    zen::thread_engine() = stream_engine(seed, ~std::uint64_t(0));
+}
+
+// Pre-generated streams (thresholds, outcome patterns) hold about this many values in
+// all: bounded memory at any --size, and a period a small --size cannot learn
+constexpr std::size_t stream_values = std::size_t(1) << 20;
+
+// Rows of 'size' values such a stream keeps for 'iter' outer iterations; they repeat
+// after that
+inline int stream_rows(int size, int iter) {
+    const auto rows = (stream_values + std::max(size, 1) - 1) / std::max(size, 1);
+    return static_cast<int>(std::max<std::size_t>(1, std::min<std::size_t>(std::max(iter, 1), rows)));
+}
+
+// A fresh seed for runs without --seed; printed so that the run can be repeated
+inline std::uint64_t random_seed() {
+    std::random_device rd;
+    return (std::uint64_t(rd()) << 32) ^ rd();
+}
+
+// Fills 'out' with integers in [min, max]; 'threads' = 0 uses every hardware thread
+inline void fill_dataset(std::span<int> out, int min, int max, std::uint64_t seed, unsigned threads = 0) {
+    const std::size_t chunks = (out.size() + dataset_chunk - 1) / dataset_chunk;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, chunks));
+
+    auto fill_chunks = [&](unsigned first) {
+        for (std::size_t k = first; k < chunks; k += threads) {
+            auto engine = stream_engine(seed, k);
+            zen::random_fill(engine, out.subspan(k * dataset_chunk, std::min(dataset_chunk, out.size() - k * dataset_chunk)), min, max);
+        }
+    };
+
+    if (threads <= 1) {
+        fill_chunks(0);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++)
+        workers.emplace_back(fill_chunks, t);
+    fill_chunks(0);
+    for (auto& w : workers)
+        w.join();
+}
+
+inline std::vector<int> make_dataset(int size, int min, int max, std::uint64_t seed, unsigned threads = 0) {
+    std::vector<int> numbers(size);
+    fill_dataset(numbers, min, max, seed, threads);
+    return numbers;
+}
+
+// Controlled disorder on sorted data, for nearly-sorted inputs such as timestamps with
+// stragglers. 'fraction' is the share of elements affected:
+//   swaps          fraction * n / 2 swaps of two random elements
+//   block_shuffle  that share of blocks trades places among itself
+//   reversed_runs  that share of blocks is reversed in place
+// Blocks are 256 elements, or n/64 on inputs too small for 64 such blocks.
+enum class disorder { swaps, block_shuffle, reversed_runs };
+
+constexpr std::uint64_t disorder_stream_id = ~std::uint64_t(2);
+constexpr std::size_t   disorder_block     = 256;
+
+// Fisher-Yates on zen::bounded_random; unlike std::shuffle the result is the same with
+// every standard library, which keeps seeded runs comparable across machines
+template<class T, class Engine>
+void shuffle(std::vector<T>& v, Engine& engine) {
+    for (std::size_t k = v.size(); k > 1; k--)
+        std::swap(v[k - 1], v[zen::bounded_random(engine, k)]);
+}
+
+inline const char* disorder_id(disorder kind) {
+    switch (kind) {
+        case disorder::swaps:         return "swaps";
+        case disorder::block_shuffle: return "block_shuffle";
+        case disorder::reversed_runs: return "reversed_runs";
+    }
+    return "?";
+}
+
+inline const char* disorder_name(disorder kind) {
+    switch (kind) {
+        case disorder::swaps:         return "Swaps";
+        case disorder::block_shuffle: return "Block shuffle";
+        case disorder::reversed_runs: return "Reversed runs";
+    }
+    return "?";
+}
+
+inline void apply_disorder(std::vector<int>& numbers, disorder kind, double fraction, std::uint64_t seed) {
+    auto engine = stream_engine(seed, disorder_stream_id);
+    const std::size_t n = numbers.size();
+    if (n < 2 || fraction <= 0)
+        return;
+
+    if (kind == disorder::swaps) {
+        const auto count = static_cast<std::size_t>(fraction * n / 2);
+        for (std::size_t k = 0; k < count; k++)
+            std::swap(numbers[zen::bounded_random(engine, n)], numbers[zen::bounded_random(engine, n)]);
+        return;
+    }
+
+    // Pick the affected blocks: a random subset of the requested share
+    const std::size_t length = std::clamp<std::size_t>(n / 64, 1, disorder_block);
+    const std::size_t blocks = (n + length - 1) / length;
+    std::vector<std::size_t> picked(blocks);
+    for (std::size_t b = 0; b < blocks; b++)
+        picked[b] = b;
+    shuffle(picked, engine);
+    picked.resize(std::min(blocks, static_cast<std::size_t>(fraction * blocks + 0.5)));
+    auto block = [&](std::size_t b) {
+        return numbers.begin() + static_cast<std::ptrdiff_t>(b * length);
+    };
+    auto block_end = [&](std::size_t b) {
+        return numbers.begin() + static_cast<std::ptrdiff_t>(std::min(n, (b + 1) * length));
+    };
+
+    if (kind == disorder::reversed_runs) {
+        for (auto b : picked)
+            std::reverse(block(b), block_end(b));
+        return;
+    }
+
+    // Block shuffle: the picked blocks are gathered and written back to the same positions
+    // in a random order. Only full blocks move, so every destination has room.
+    std::erase_if(picked, [&](std::size_t b) { return (b + 1) * length > n; });
+    if (picked.size() < 2)
+        return;
+    std::vector<int> moved;
+    moved.reserve(picked.size() * length);
+    for (auto b : picked)
+        moved.insert(moved.end(), block(b), block_end(b));
+    shuffle(picked, engine);
+    for (std::size_t k = 0; k < picked.size(); k++)
+        std::copy_n(moved.begin() + static_cast<std::ptrdiff_t>(k * length), length, block(picked[k]));
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+// Fixed-memory latency histogram in the style of HdrHistogram: values below 128 get a
+// bucket each, and every power of two above that is split into 64 linear sub-buckets,
+// so any value up to 2^64 is kept to within 1/64 (1.6%) in 3776 counters. Recording
+// is one relaxed atomic add, so threads can share a histogram without a lock.
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <array>
+#include <cmath>
+
+// The tail of one case: per-batch latencies in nanoseconds; count = 0 when not recorded
+struct latency_percentiles {
+    std::uint64_t count = 0;
+    double        p50   = 0;
+    double        p90   = 0;
+    double        p99   = 0;
+    double        p999  = 0;
+    double        max   = 0;
+};
+
+class latency_histogram {
+public:
+    static constexpr int linear_limit = 128; // values below this are exact
+    static constexpr int sub_buckets  = 64;  // per power of two above it
+    static constexpr int bucket_count = linear_limit + (64 - 7) * sub_buckets;
+
+    void record(std::uint64_t value) {
+        counts_[index(value)].fetch_add(1, std::memory_order_relaxed);
+        total_.fetch_add(1, std::memory_order_relaxed);
+        auto seen = max_.load(std::memory_order_relaxed);
+        while (value > seen && !max_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+    }
+
+    std::uint64_t count() const { return total_.load(std::memory_order_relaxed); }
+    std::uint64_t max()   const { return max_.load(std::memory_order_relaxed); }
+
+    // Highest value equivalent to the one at quantile q (0..1), capped at the exact max
+    std::uint64_t value_at(double q) const {
+        const auto total = count();
+        if (total == 0)
+            return 0;
+        const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(q * total)));
+        std::uint64_t seen = 0;
+        for (int k = 0; k < bucket_count; k++) {
+            seen += counts_[k].load(std::memory_order_relaxed);
+            if (seen >= rank)
+                return std::min(highest_equivalent(k), max());
+        }
+        return max();
+    }
+
+    latency_percentiles percentiles() const {
+        latency_percentiles p;
+        p.count = count();
+        p.p50   = static_cast<double>(value_at(0.5));
+        p.p90   = static_cast<double>(value_at(0.9));
+        p.p99   = static_cast<double>(value_at(0.99));
+        p.p999  = static_cast<double>(value_at(0.999));
+        p.max   = static_cast<double>(max());
+        return p;
+    }
+
+    void reset() {
+        for (auto& c : counts_)
+            c.store(0, std::memory_order_relaxed);
+        total_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    // Above the linear range the value's top 7 bits pick the sub-bucket and its
+    // magnitude the group
+    static int index(std::uint64_t value) {
+        if (value < linear_limit)
+            return static_cast<int>(value);
+        const int shift = std::bit_width(value) - 7;
+        const auto top  = static_cast<int>(value >> shift); // 64..127
+        return linear_limit + (shift - 1) * sub_buckets + (top - sub_buckets);
+    }
+
+    static std::uint64_t highest_equivalent(int k) {
+        if (k < linear_limit)
+            return static_cast<std::uint64_t>(k);
+        const int shift = (k - linear_limit) / sub_buckets + 1;
+        const auto top  = static_cast<std::uint64_t>((k - linear_limit) % sub_buckets + sub_buckets);
+        return ((top + 1) << shift) - 1;
+    }
+
+    std::array<std::atomic<std::uint64_t>, bucket_count> counts_ = {};
+    std::atomic<std::uint64_t>                           total_  = 0;
+    std::atomic<std::uint64_t>                           max_    = 0;
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+// Process isolation: each case runs in a fork()ed child that hands its report back over
+// a pipe. Warm mode gives the case its own address space and heap, nothing more: the
+// branch predictor and the caches are per-core hardware state that a new process does
+// not reset, and the child shares the parent's pages copy-on-write, so the dataset is
+// still cache-hot. Only the cold mode changes that state, by evicting the caches and
+// scrubbing the predictor before every repetition, which is the state of a first
+// request after idle. POSIX only; elsewhere the cases run in-process.
+
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <string_view>
+#include <string>
+#include <vector>
+#include <utility>
+#include "measurement.h"
+#include "dataset.h"
+#include "sweep.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BPE_HAS_FORK 1
+#include <sys/wait.h>
+#include <unistd.h>
+#else
+#define BPE_HAS_FORK 0
+#endif
+
+enum class isolation { none, warm, cold };
+
+inline const char* isolation_id(isolation mode) {
+    switch (mode) {
+        case isolation::none: return "none";
+        case isolation::warm: return "warm";
+        case isolation::cold: return "cold";
+    }
+    return "?";
+}
+
+inline bool parse_isolation(std::string_view text, isolation& mode) {
+    for (auto m : {isolation::none, isolation::warm, isolation::cold}) {
+        if (text == isolation_id(m)) {
+            mode = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+constexpr bool isolation_supported() { return BPE_HAS_FORK != 0; }
+
+///////////////////////////////////////////////////////////////////////////////////////////// Cold state
+
+// Engine stream of the run seed reserved for the predictor scrub
+constexpr std::uint64_t scrub_stream_id = ~std::uint64_t(4);
+
+// Reads and writes a buffer twice the size of the last-level cache, line by line
+inline void evict_caches() {
+    static std::vector<unsigned char> buffer = [] {
+        std::size_t llc = 0;
+        for (const auto& c : detect_caches())
+            llc = std::max(llc, c.bytes);
+        return std::vector<unsigned char>(2 * llc);
+    }();
+    for (std::size_t k = 0; k < buffer.size(); k += 64)
+        buffer[k]++;
+    do_not_optimize(buffer.data());
+    clobber_memory();
+}
+
+// 64 separate branch sites, each taken on one random bit
+template<int... k>
+void random_branches(std::uint64_t bits, std::uint64_t& acc, std::integer_sequence<int, k...>) {
+    ((bits >> k & 1 ? (keep_branch(), acc += k) : (keep_branch(), acc ^= k)), ...);
+}
+
+// About 4M random outcomes over many branch sites: overwrites the pattern tables and
+// the global history with noise, so nothing learned before survives
+inline void scrub_predictor(std::uint64_t seed) {
+    auto engine = stream_engine(seed, scrub_stream_id);
+    std::uint64_t acc = 0;
+    for (int n = 0; n < (1 << 16); n++)
+        random_branches(engine(), acc, std::make_integer_sequence<int, 64>{});
+    do_not_optimize(acc);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////// Child process
+
+// The report travels as raw bytes: kept samples, then the scalars
+class report_writer {
+public:
+    template<class T>
+    void put(const T& value) {
+        const auto* bytes = reinterpret_cast<const char*>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof(T));
+    }
+    std::string data;
+};
+
+class report_reader {
+public:
+    explicit report_reader(std::string_view data) : data_(data) {}
+
+    template<class T>
+    T get() {
+        if (pos_ + sizeof(T) > data_.size())
+            throw std::runtime_error("ISOLATED CASE SENT A TRUNCATED REPORT");
+        T value;
+        std::memcpy(&value, data_.data() + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return value;
+    }
+
+private:
+    std::string_view data_;
+    std::size_t      pos_ = 0;
+};
+
+inline std::string serialise_report(const case_report& report) {
+    report_writer w;
+    w.put(static_cast<std::uint64_t>(report.time.samples.size()));
+    for (double x : report.time.samples)
+        w.put(x);
+    w.put(report.time.rejected);
+    w.put(report.cycles);
+    for (const auto& v : report.counters.values) {
+        w.put(static_cast<std::uint8_t>(v.has_value()));
+        w.put(v.value_or(0));
+    }
+    w.put(report.warmup.runs);
+    w.put(report.warmup.seconds);
+    w.put(report.warmup.spread);
+    w.put(static_cast<std::uint8_t>(report.warmup.converged));
+    return w.data;
+}
+
+inline case_report deserialise_report(std::string_view data) {
+    report_reader r(data);
+    case_report report;
+    std::vector<double> samples(r.get<std::uint64_t>());
+    for (auto& x : samples)
+        x = r.get<double>();
+    const int rejected = r.get<int>();
+    report.time   = summarize(std::move(samples), rejected); // the child already dropped outliers
+    report.cycles = r.get<double>();
+    for (auto& v : report.counters.values) {
+        const bool present = r.get<std::uint8_t>() != 0;
+        const auto value   = r.get<std::uint64_t>();
+        if (present)
+            v = value;
+    }
+    report.warmup.runs      = r.get<int>();
+    report.warmup.seconds   = r.get<double>();
+    report.warmup.spread    = r.get<double>();
+    report.warmup.converged = r.get<std::uint8_t>() != 0;
+    return report;
+}
+
+// measure() in a fresh child process. Warm: the usual warm-up and repetitions. Cold: no
+// warm-up, and every repetition starts from evicted caches and a scrubbed predictor.
+template<class Run>
+case_report measure_isolated(Run&& run, const repetition_policy& policy, isolation mode, std::uint64_t seed) {
+    auto measure_here = [&] {
+        if (mode != isolation::cold)
+            return measure(run, policy);
+        repetition_policy cold = policy;
+        cold.warmup_tolerance = 0;
+        return measure(run, cold, [&] {
+            evict_caches();
+            scrub_predictor(seed);
+        });
+    };
+#if BPE_HAS_FORK
+    if (mode == isolation::none)
+        return measure_here();
+
+    int fds[2];
+    if (pipe(fds) != 0)
+        throw std::runtime_error("CANNOT CREATE PIPE FOR ISOLATED CASE");
+    std::fflush(nullptr); // the child must not flush the parent's buffered output again
+    const pid_t pid = fork();
+    if (pid < 0)
+        throw std::runtime_error("CANNOT FORK ISOLATED CASE");
+
+    if (pid == 0) {
+        close(fds[0]);
+        shared_counters().reopen();
+        const auto bytes = serialise_report(measure_here());
+        std::size_t sent = 0;
+        while (sent < bytes.size()) {
+            const auto n = write(fds[1], bytes.data() + sent, bytes.size() - sent);
+            if (n <= 0)
+                _exit(1);
+            sent += static_cast<std::size_t>(n);
+        }
+        _exit(0); // no destructors or atexit handlers of the parent's state
+    }
+
+    close(fds[1]);
+    std::string bytes;
+    char buffer[4096];
+    for (ssize_t n; (n = read(fds[0], buffer, sizeof(buffer))) > 0; )
+        bytes.append(buffer, static_cast<std::size_t>(n));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        throw std::runtime_error("ISOLATED CASE FAILED");
+    return deserialise_report(bytes);
+#else
+    return measure_here();
+#endif
+}
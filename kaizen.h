@@ -42,9 +42,12 @@
 #include <sstream>
 #include <ostream>
 #include <utility>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <random>
+#include <tuple>
+#include <span>
 #include <chrono>
 #include <atomic>
 #include <regex>
@@ -57,6 +60,18 @@
 #include <set>
 #include <map>
 
+// Time-stamp counter intrinsics for zen::tsc_timer
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ZEN_HAS_TSC 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#define ZEN_HAS_TSC 0
+#endif
+
 namespace zen {
 
 ///////////////////////////////////////////////////////////////////////////////////////////// MISC
@@ -1695,6 +1710,115 @@ auto measure_execution(std::function<void()> operation)
     return t.duration<Duration>();
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////// zen::tsc_timer
+
+// Cycle-accurate alternative to zen::timer on the time-stamp counter. start() reads the
+// counter after an lfence and stop() uses rdtscp followed by an lfence, so the timed
+// region can neither begin early nor retire late. The counter ticks at a constant
+// reference rate, which calibrate() measures against std::chrono::steady_clock together
+// with the cost of an empty start()/stop() pair; that overhead is subtracted from every
+// duration. On targets without a TSC the steady_clock nanosecond count stands in.
+// Example: zen::tsc_timer::calibrate();
+//          zen::tsc_timer t; t.start(); work(); t.stop();
+//          t.cycles(); t.duration<zen::timer::nsec>();
+class tsc_timer {
+public:
+    struct calibration {
+        double        ghz      = 1; // counter ticks per nanosecond
+        std::uint64_t overhead = 0; // ticks of an empty start()/stop() pair
+    };
+
+    static bool supported() { return ZEN_HAS_TSC; }
+
+    // Call once before timing anything; later calls return the cached calibration
+    static const calibration& calibrate(std::chrono::milliseconds window = std::chrono::milliseconds(50))
+    {
+        static const calibration cal = measure_calibration(window);
+        return cal;
+    }
+
+    auto start() { start_ = read_start(); return *this; }
+    auto stop()  {  stop_ = read_stop();  return *this; }
+
+    // One raw counter reading, ordered after everything before it: for timestamping
+    // many points of one run without a start()/stop() pair each
+    static std::uint64_t stamp() { return read_stop(); }
+
+    // Ticks between start() and stop() with the calibrated overhead removed
+    std::uint64_t cycles() const {
+        const auto raw = stop_ - start_;
+        const auto overhead = calibrate().overhead;
+        return raw > overhead ? raw - overhead : 0;
+    }
+
+    template<class Duration>
+    auto elapsed() const {
+        return to_duration<Duration>(read_stop() - start_);
+    }
+
+    template<class Duration>
+    auto duration() const {
+        return to_duration<Duration>(cycles());
+    }
+
+    auto duration_string() const {
+        return adaptive_duration(duration<timer::nsec>());
+    }
+
+private:
+    static std::uint64_t read_start() {
+#if ZEN_HAS_TSC
+        _mm_lfence();
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static std::uint64_t read_stop() {
+#if ZEN_HAS_TSC
+        unsigned int aux;
+        const auto t = __rdtscp(&aux);
+        _mm_lfence();
+        return t;
+#else
+        return read_start();
+#endif
+    }
+
+    template<class Duration>
+    static Duration to_duration(std::uint64_t ticks) {
+        const auto ns = std::chrono::duration<double, std::nano>(ticks / calibrate().ghz);
+        return std::chrono::duration_cast<Duration>(ns);
+    }
+
+    static calibration measure_calibration(std::chrono::milliseconds window) {
+        calibration cal;
+#if ZEN_HAS_TSC
+        const auto t0 = std::chrono::steady_clock::now();
+        const auto c0 = read_start();
+        auto t1 = t0;
+        while (t1 - t0 < window)
+            t1 = std::chrono::steady_clock::now();
+        const auto c1 = read_stop();
+        cal.ghz = (c1 - c0) / std::chrono::duration<double, std::nano>(t1 - t0).count();
+#endif
+        // The cheapest of many empty pairs is the fixed cost of the fences and reads
+        std::uint64_t overhead = UINT64_MAX;
+        for (int i = 0; i < 1000; ++i) {
+            const auto a = read_start();
+            const auto b = read_stop();
+            overhead = std::min<std::uint64_t>(overhead, b - a);
+        }
+        cal.overhead = overhead;
+        return cal;
+    }
+
+    std::uint64_t start_ = 0;
+    std::uint64_t  stop_ = 0;
+};
+
 ///////////////////////////////////////////////////////////////////////////////////////////// zen::unordered_map
 
 template<
@@ -1913,44 +2037,229 @@ zen::string repeat(const int n, const std::string_view s) {
 
 ///////////////////////////////////////////////////////////////////////////////////////////// MAIN UTILITIES
 
+// ------------------------------------------------------------------------------------------ random engines
+
+// Small, fast engines that satisfy UniformRandomBitGenerator, so they also
+// work with the standard distributions. All three produce 64-bit outputs.
+namespace internal {
+    // Full 64x64 -> 128-bit product, returned as (low, high)
+    inline std::pair<std::uint64_t, std::uint64_t> mul128(std::uint64_t a, std::uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+        const auto p = static_cast<unsigned __int128>(a) * b;
+        return {static_cast<std::uint64_t>(p), static_cast<std::uint64_t>(p >> 64)};
+#elif defined(_MSC_VER) && defined(_M_X64)
+        std::uint64_t hi;
+        const std::uint64_t lo = _umul128(a, b, &hi);
+        return {lo, hi};
+#else
+        const std::uint64_t a_lo = a & 0xffffffff, a_hi = a >> 32;
+        const std::uint64_t b_lo = b & 0xffffffff, b_hi = b >> 32;
+        const std::uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+        const std::uint64_t mid = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+        return {(mid << 32) | (ll & 0xffffffff), hh + (lh >> 32) + (hl >> 32) + (mid >> 32)};
+#endif
+    }
+
+    inline std::uint64_t rotl(std::uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    inline std::uint64_t rotr(std::uint64_t x, int k) { return (x >> k) | (x << ((64 - k) & 63)); }
+
+    // Expands one 64-bit seed into well-mixed state words
+    inline std::uint64_t splitmix64(std::uint64_t& x) {
+        std::uint64_t z = (x += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+} // namespace internal
+
+// xoshiro256** by Blackman and Vigna: the default engine. jump() advances by 2^128
+// outputs, which splits one seed into non-overlapping streams.
+class xoshiro256ss {
+public:
+    using result_type = std::uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    explicit xoshiro256ss(std::uint64_t seed = 0x9e3779b97f4a7c15) {
+        for (auto& w : s_)
+            w = internal::splitmix64(seed);
+    }
+
+    result_type operator()() {
+        const auto result = internal::rotl(s_[1] * 5, 7) * 9;
+        const auto t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = internal::rotl(s_[3], 45);
+        return result;
+    }
+
+    void jump() {
+        static constexpr std::uint64_t polynomial[] = {
+            0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c
+        };
+        std::uint64_t t[4] = {};
+        for (auto word : polynomial) {
+            for (int b = 0; b < 64; b++) {
+                if (word & (std::uint64_t(1) << b))
+                    for (int k = 0; k < 4; k++)
+                        t[k] ^= s_[k];
+                (*this)();
+            }
+        }
+        for (int k = 0; k < 4; k++)
+            s_[k] = t[k];
+    }
+
+private:
+    std::uint64_t s_[4];
+};
+
+// PCG64 (XSL-RR output on a 128-bit LCG) by O'Neill
+class pcg64 {
+public:
+    using result_type = std::uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    explicit pcg64(std::uint64_t seed = 0xcafef00dd15ea5e5, std::uint64_t stream = 0xa02bdbf7bb3c0a7) {
+        inc_lo_ = (stream << 1) | 1;
+        inc_hi_ = stream >> 63;
+        step();
+        add(0, seed);
+        step();
+    }
+
+    result_type operator()() {
+        step();
+        return internal::rotr(hi_ ^ lo_, static_cast<int>(hi_ >> 58));
+    }
+
+private:
+    void add(std::uint64_t hi, std::uint64_t lo) {
+        const auto sum = lo_ + lo;
+        hi_ += hi + (sum < lo_);
+        lo_  = sum;
+    }
+
+    // state = state * multiplier + increment (mod 2^128)
+    void step() {
+        constexpr std::uint64_t mul_hi = 0x2360ed051fc65da4, mul_lo = 0x4385df649fccf645;
+        const auto [lo, hi] = internal::mul128(lo_, mul_lo);
+        hi_ = hi + hi_ * mul_lo + lo_ * mul_hi;
+        lo_ = lo;
+        add(inc_hi_, inc_lo_);
+    }
+
+    std::uint64_t hi_ = 0, lo_ = 0;
+    std::uint64_t inc_hi_ = 0, inc_lo_ = 0;
+};
+
+// wyrand by Wang Yi: one add and one 128-bit multiply per output, the fastest of the three
+class wyrand {
+public:
+    using result_type = std::uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    explicit wyrand(std::uint64_t seed = 0) : state_(seed) {}
+
+    result_type operator()() {
+        state_ += 0xa0761d6478bd642f;
+        const auto [lo, hi] = internal::mul128(state_, state_ ^ 0xe7037ed1a0b428db);
+        return lo ^ hi;
+    }
+
+private:
+    std::uint64_t state_;
+};
+
+// The calling thread's own engine of the given type, seeded once per thread from
+// std::random_device. Being thread_local it needs no locking and has no data race.
+template<class Engine = xoshiro256ss>
+Engine& thread_engine() {
+    thread_local Engine engine([] {
+        std::random_device rd;
+        return (std::uint64_t(rd()) << 32) ^ rd();
+    }());
+    return engine;
+}
+
+// Unbiased integer in [0, range) by Lemire's nearly divisionless method: one multiply
+// per value, and a division only on the rare path where rejection is possible.
+template<class Engine>
+std::uint64_t bounded_random(Engine& engine, std::uint64_t range) {
+    auto [lo, hi] = internal::mul128(engine(), range);
+    if (lo < range) {
+        const std::uint64_t threshold = (0 - range) % range;
+        while (lo < threshold)
+            std::tie(lo, hi) = internal::mul128(engine(), range);
+    }
+    return hi;
+}
+
+// ------------------------------------------------------------------------------------------ random_int
+
 // Example: random_int();
-// Result: A random integer between [min, max)
-template<class T = int>
+// Result: A random integer between [min, max], both inclusive
+// Each thread draws from its own engine (see thread_engine()), so concurrent calls are
+// safe, and no distribution object is constructed per call.
+// Example: random_int<int, zen::wyrand>(0, 100); // picks the engine
+template<class T = int, class Engine = xoshiro256ss>
 T random_int(const T min = 0, const T max = 10) {
-    // Reasons why the std::random_device and the std::mt19937 are 'static' below:
-    // ---------------------------------------------------------------------------------------------------------------
-    // 1. Initialization Efficiency:
-    // Random devices and generators often involve some computational cost due to entropy gathering, seeding, generator
-    // initialization and good old algorithmic complexity. By declaring them as static, they are initialized only once,
-    // the first time the function is called. Subsequent calls to to this function reuse the existing instances, avoiding the overhead.
-    // ---------------------------------------------------------------------------------------------------------------
-    // 2. State Preservation:
-    // Random number generators like std::mt19937 maintain an internal state that evolves as numbers are generated.
-    // This state determines the sequence of random numbers produced. By making the std::mt19937 object static,
-    // the state is preserved across calls to this function, ensuring a proper random sequence. If the std::mt19937
-    // object were reinitialized on every call, it might lead to repeated or patterned sequences, undermining the randomness.
-    // ---------------------------------------------------------------------------------------------------------------
-    // 3. Thread Safety Considerations:
-    // Declaring these variables as static within a function means they are shared across all calls to that function
-    // within the program, regardless of where it's called from. This could potentially raise thread-safety issues if the
-    // function is called simultaneously from multiple threads. However, in most common usage scenarios where thread
-    // safety is not a concern, using static variables for this purpose is fine.
-    // ---------------------------------------------------------------------------------------------------------------
-    // 4. Resource Management
-    // Since the std::random_device and the std::mt19937 object are static, they are not destroyed when the function returns,
-    // but rather when the program ends. This ensures that the same random device and generator instances are reused
-    // throughout the lifetime of the program, optimizing resource management.
-    // ---------------------------------------------------------------------------------------------------------------
-    // 5. Avoiding Repetition
-    // If we didn't make these objects static, and the random number generator was reseeded with the same or similar
-    // seeds (which might happen if the function is called in quick succession), you might get the same or similar random
-    // numbers in different calls. Making these static ensures a more varied and truly random sequence.
-    // ---------------------------------------------------------------------------------------------------------------
-    // The 'static' below is for reasons outlined above.
-    static std::random_device        rd;
-    static std::mt19937              gen(rd());
-    std::uniform_int_distribution<T> dis(min, max);
-    return dis(gen);
+    ZEN_STATIC_ASSERT(std::is_integral_v<T>, "TEMPLATE PARAMETER EXPECTED TO BE INTEGRAL, BUT IS NOT");
+    const auto range = static_cast<std::uint64_t>(max) - static_cast<std::uint64_t>(min) + 1;
+    if (range == 0) // the full 64-bit range
+        return static_cast<T>(thread_engine<Engine>()());
+    return static_cast<T>(static_cast<std::uint64_t>(min) + bounded_random(thread_engine<Engine>(), range));
+}
+
+// Fills 'out' with random integers in [min, max], both inclusive. Values are produced in
+// blocks: a tight multiply loop over 32-bit draws that compilers vectorise, followed by a
+// scalar pass that redraws the rare values Lemire's method must reject.
+// Example: std::vector<int> v(1'000'000);
+//          zen::random_fill(std::span(v), -100, 100);
+template<class T, class Engine>
+void random_fill(Engine& engine, std::span<T> out, const T min, const T max) {
+    ZEN_STATIC_ASSERT(std::is_integral_v<T>, "TEMPLATE PARAMETER EXPECTED TO BE INTEGRAL, BUT IS NOT");
+    const auto range = static_cast<std::uint64_t>(max) - static_cast<std::uint64_t>(min) + 1;
+    if (range == 0 || range > UINT32_MAX) {
+        for (auto& x : out)
+            x = static_cast<T>(static_cast<std::uint64_t>(min) + (range ? bounded_random(engine, range) : engine()));
+        return;
+    }
+
+    constexpr std::size_t block = 256;
+    const auto range32   = static_cast<std::uint32_t>(range);
+    const auto threshold = static_cast<std::uint32_t>((0 - range32) % range32);
+    std::uint32_t draws[block];
+    std::uint64_t products[block];
+
+    for (std::size_t base = 0; base < out.size(); base += block) {
+        const std::size_t n = std::min(block, out.size() - base);
+        for (std::size_t k = 0; k < n; k += 2) {
+            const auto bits = engine();
+            draws[k] = static_cast<std::uint32_t>(bits);
+            if (k + 1 < n)
+                draws[k + 1] = static_cast<std::uint32_t>(bits >> 32);
+        }
+        for (std::size_t k = 0; k < n; k++)
+            products[k] = std::uint64_t(draws[k]) * range32;
+        for (std::size_t k = 0; k < n; k++) {
+            while (static_cast<std::uint32_t>(products[k]) < threshold)
+                products[k] = std::uint64_t(static_cast<std::uint32_t>(engine())) * range32;
+            out[base + k] = static_cast<T>(static_cast<std::uint64_t>(min) + (products[k] >> 32));
+        }
+    }
+}
+
+// Same as above with the calling thread's engine
+template<class T, class Engine = xoshiro256ss>
+void random_fill(std::span<T> out, const T min, const T max) {
+    random_fill(thread_engine<Engine>(), out, min, max);
 }
 
 // Very often all we want is a dead simple way of quickly
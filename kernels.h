@@ -0,0 +1,453 @@
+#pragma once
+
+// Policy-based benchmark kernels. Every case is one specialisation of run_kernel() over
+//   Ordering x Predicate x Workload x Select x Accumulator
+// so all cases share the same loop, the same timing scaffolding and the same codegen
+// quality. The Ordering is applied to the data once, before anything is timed.
+// case_registry instantiates every combination; adding a policy to one of the
+// type lists below adds the corresponding cases everywhere.
+
+#include <type_traits>
+#include <cstdint>
+#include <string_view>
+#include <functional>
+#include <algorithm>
+#include <utility>
+#include <string>
+#include <vector>
+#include <array>
+#include <span>
+#include <cmath>
+#include <map>
+#include "kaizen.h"
+#include "measurement.h"
+#include "dataset.h"
+#include "simd_kernels.h"
+#include "sorting.h"
+
+template<class... Ts> struct type_list {};
+
+template<class... Ts, class F>
+void for_each_type(type_list<Ts...>, F&& f) {
+    (f(std::type_identity<Ts>{}), ...);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////// Ordering
+
+struct unsorted_order {
+    static constexpr const char* id    = "unsorted";
+    static constexpr const char* label = "Unsorted";
+    static void apply(std::vector<int>&) {}
+};
+
+// Sorted once per registry, with the algorithm chosen by --sort
+struct sorted_order {
+    static constexpr const char* id    = "sorted";
+    static constexpr const char* label = "Sorted";
+    static inline sort_algorithm algorithm = sort_algorithm::std_sort;
+    static void apply(std::vector<int>& numbers) { sort_numbers(numbers, algorithm); }
+};
+
+using orderings = type_list<unsorted_order, sorted_order>;
+
+///////////////////////////////////////////////////////////////////////////////////////////// Predicate
+
+// Each predicate yields the threshold compared against numbers[j] in outer iteration i
+
+// The predictable cases: a fixed threshold, so the outcome is fixed per element
+struct fixed_threshold {
+    static constexpr const char* id    = "predictable";
+    static constexpr const char* label = "Predictable";
+    int value;
+    int operator()(int, int) const { return value; }
+};
+
+// Draws the threshold inside the timed loop (the original behaviour)
+struct inline_threshold {
+    static constexpr const char* id    = "unpredictable";
+    static constexpr const char* label = "Unpredictable";
+    int size;
+    int operator()(int, int) const { return zen::random_int(0, size); }
+};
+
+// Random thresholds for the unpredictable cases, generated before any timer starts.
+// Each outer iteration reads its own row; rows repeat after stream_rows() iterations,
+// which keeps the replayed period (about 2^20 values, or one row of a larger --size)
+// far beyond any branch history length while bounding memory at any --size and --iter.
+struct threshold_stream {
+    static constexpr const char* id    = "unpredictable";
+    static constexpr const char* label = "Unpredictable";
+
+    threshold_stream(int size, int iter)
+        : size_(size), rows_(stream_rows(size, iter)), data_(size_t(size) * rows_)
+    {
+        zen::random_fill(std::span(data_), 0, size);
+    }
+
+    int operator()(int i, int j) const { return data_[size_t(i % rows_) * size_ + j]; }
+
+private:
+    int              size_;
+    int              rows_;
+    std::vector<int> data_;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// Workload
+
+struct simple_workload {
+    static constexpr const char* id    = "simple";
+    static constexpr const char* label = "";
+    double operator()(int value) const { return value; }
+};
+
+// Simulate a computationally expensive function
+inline double complex_process(int value) {
+    double result = std::sin(value);
+    return result;
+}
+
+struct complex_workload {
+    static constexpr const char* id    = "complex";
+    static constexpr const char* label = " Complex";
+    double operator()(int value) const { return complex_process(value); }
+};
+
+using workloads = type_list<simple_workload, complex_workload>;
+
+///////////////////////////////////////////////////////////////////////////////////////////// Select
+
+// How 'threshold > value ? value : pivot' reaches the accumulator. The branchy form is the
+// original if/else; the others are branchless twins that compile to straight-line code.
+// keep_branch() stops the compiler from if-converting the branchy form once the
+// accumulator no longer touches memory.
+
+struct branchy_select {
+    static constexpr const char* id    = "branchy";
+    static constexpr const char* label = "Branchy";
+    template<class Workload, class Accumulator>
+    void operator()(bool take, int value, int pivot, const Workload& work, Accumulator&& acc) const {
+        if (take) {
+            keep_branch();
+            acc.add(work(value));
+        }
+        else {
+            keep_branch();
+            acc.add(work(pivot));
+        }
+    }
+};
+
+struct mask_select {
+    static constexpr const char* id    = "mask";
+    static constexpr const char* label = "Mask";
+    template<class Workload, class Accumulator>
+    void operator()(bool take, int value, int pivot, const Workload& work, Accumulator&& acc) const {
+        const int mask = -static_cast<int>(take);
+        acc.add(work((value & mask) | (pivot & ~mask)));
+    }
+};
+
+struct cmov_select {
+    static constexpr const char* id    = "select";
+    static constexpr const char* label = "Select";
+    template<class Workload, class Accumulator>
+    void operator()(bool take, int value, int pivot, const Workload& work, Accumulator&& acc) const {
+        acc.add(work(take ? value : pivot));
+    }
+};
+
+struct lookup_select {
+    static constexpr const char* id    = "lookup";
+    static constexpr const char* label = "Lookup";
+    template<class Workload, class Accumulator>
+    void operator()(bool take, int value, int pivot, const Workload& work, Accumulator&& acc) const {
+        const int options[2] = {pivot, value};
+        acc.add(work(options[take]));
+    }
+};
+
+// Control: always the element itself, no data-dependent choice at all
+struct control_select {
+    static constexpr const char* id    = "control";
+    static constexpr const char* label = "Control";
+    template<class Workload, class Accumulator>
+    void operator()(bool, int value, int, const Workload& work, Accumulator&& acc) const {
+        acc.add(work(value));
+    }
+};
+
+using selects = type_list<branchy_select, mask_select, cmov_select, lookup_select>;
+
+///////////////////////////////////////////////////////////////////////////////////////////// Accumulator
+
+// run_kernel() feeds element j + k of every group of 'lanes' elements to lane<k>(),
+// calls flush() after each outer iteration and finish() once at the end.
+
+// The original sink: a volatile double, one load and one store per element. Every add
+// waits for the previous store to forward, so the loop is bound by that latency.
+struct volatile_accumulator {
+    static constexpr const char* id    = "volatile";
+    static constexpr const char* label = "Volatile";
+    static constexpr int lanes = 1;
+    volatile double& sum;
+    void add(double x) { sum += x; }
+    template<int>
+    volatile_accumulator& lane() { return *this; }
+    void flush() {}
+    void finish() {}
+};
+
+// 'Lanes' independent partial sums in registers. Each is one add-latency chain, so more
+// lanes leave less of the time to latency and more to the branch. The partial sums
+// escape through do_not_optimize() once per outer iteration and reach the volatile
+// sink once per run.
+template<int Lanes>
+struct local_accumulator {
+    static_assert(Lanes == 1 || Lanes == 2 || Lanes == 4 || Lanes == 8);
+    static constexpr const char* id    = Lanes == 1 ? "local1" : Lanes == 2 ? "local2" : Lanes == 4 ? "local4" : "local8";
+    static constexpr const char* label = Lanes == 1 ? "1 Chain" : Lanes == 2 ? "2 Chains" : Lanes == 4 ? "4 Chains" : "8 Chains";
+    static constexpr int lanes = Lanes;
+
+    struct lane_sum {
+        double& sum;
+        void add(double x) { sum += x; }
+    };
+
+    volatile double&          sink;
+    std::array<double, Lanes> sums = {};
+
+    template<int k>
+    lane_sum lane() { return {sums[k]}; }
+
+    void flush() {
+        for (auto& s : sums)
+            do_not_optimize(s);
+    }
+
+    void finish() {
+        double total = 0;
+        for (double s : sums)
+            total += s;
+        sink += total;
+    }
+};
+
+using accumulators = type_list<volatile_accumulator, local_accumulator<1>, local_accumulator<2>,
+                               local_accumulator<4>, local_accumulator<8>>;
+
+// The selects the accumulator variants are registered for: the branch and its cmov twin.
+// Only the simple workload gets them; the complex one is bound by sin(), not the sink.
+using accumulator_selects = type_list<branchy_select, cmov_select>;
+
+///////////////////////////////////////////////////////////////////////////////////////////// Kernels
+
+// Elements [begin, end) of outer iteration i
+template<class Select, class Workload, class Predicate, class Accumulator>
+inline void kernel_pass(const Select& select, const Workload& work, const std::vector<int>& numbers, const Predicate& predicate,
+                        int i, int begin, int end, int pivot, Accumulator& acc) {
+    constexpr int lanes = Accumulator::lanes;
+    int j = begin;
+    for (; j + lanes <= end; j += lanes) {
+        [&]<int... k>(std::integer_sequence<int, k...>) {
+            (select(predicate(i, j + k) > numbers[j + k], numbers[j + k], pivot, work, acc.template lane<k>()), ...);
+        }(std::make_integer_sequence<int, lanes>{});
+    }
+    for (; j < end; j++) {
+        select(predicate(i, j) > numbers[j], numbers[j], pivot, work, acc.template lane<0>());
+    }
+}
+
+template<class Select, class Workload, class Predicate, class Accumulator>
+case_result run_kernel(const std::vector<int>& numbers, const Predicate& predicate, int iter, int size, Accumulator acc) {
+    const Select   select{};
+    const Workload work{};
+    const int      pivot = numbers[size/2];
+    case_probe probe;
+    probe.start();
+    for (int i = 0; i < iter; i++) {
+        kernel_pass(select, work, numbers, predicate, i, 0, size, pivot, acc);
+        acc.flush();
+    }
+    acc.finish();
+    return probe.stop();
+}
+
+// run_kernel() with every batch of 'batch' elements (0 = a whole pass) timed into
+// 'latencies'. Not a timed sample: the batch timers add to the total.
+template<class Select, class Workload, class Predicate, class Accumulator>
+void run_batched_kernel(const std::vector<int>& numbers, const Predicate& predicate, int iter, int size, Accumulator acc,
+                        int batch, latency_histogram& latencies) {
+    const Select   select{};
+    const Workload work{};
+    const int      pivot = numbers[size/2];
+    const int      step  = batch > 0 ? std::min(batch, size) : size;
+    batch_timer timer;
+    for (int i = 0; i < iter; i++) {
+        for (int begin = 0; begin < size; begin += step) {
+            timer.start();
+            kernel_pass(select, work, numbers, predicate, i, begin, std::min(size, begin + step), pivot, acc);
+            latencies.record(timer.stop());
+        }
+        acc.flush();
+    }
+    acc.finish();
+}
+
+// run_kernel() with a time-stamp counter reading after every outer iteration: stamps[0]
+// before the first and stamps[i + 1] after iteration i. 'stamps' holds iter + 1 entries
+// and is allocated by the caller, so nothing but the readings happens in the loop.
+template<class Select, class Workload, class Predicate, class Accumulator>
+void run_stamped_kernel(const std::vector<int>& numbers, const Predicate& predicate, int iter, int size, Accumulator acc,
+                        std::span<std::uint64_t> stamps) {
+    const Select   select{};
+    const Workload work{};
+    const int      pivot = numbers[size/2];
+    stamps[0] = zen::tsc_timer::stamp();
+    for (int i = 0; i < iter; i++) {
+        kernel_pass(select, work, numbers, predicate, i, 0, size, pivot, acc);
+        acc.flush();
+        stamps[i + 1] = zen::tsc_timer::stamp();
+    }
+    acc.finish();
+}
+
+// Control loop: the RNG calls of the inline unpredictable cases without any branch,
+// so that (Unpredictable - RNG Only) isolates the misprediction cost
+inline case_result run_rng_only(int iter, int size, volatile double& sum) {
+    case_probe probe;
+    probe.start();
+    for (int i = 0; i < iter; i++) {
+        for (int j = 0; j < size; j++) {
+            sum += zen::random_int(0, size);
+        }
+    }
+    return probe.stop();
+}
+
+// Vectorised predictable case for one instruction set. The threshold is re-read from a
+// volatile each outer iteration so the compiler cannot hoist the whole pass out of the loop.
+inline case_result run_simd_predictable(simd_isa isa, const std::vector<int>& numbers, int iter, int size, volatile double& sum) {
+    volatile int threshold = size/2;
+    case_probe probe;
+    probe.start();
+    for (int i = 0; i < iter; i++) {
+        sum += static_cast<double>(predicate_sum(isa, numbers.data(), numbers.size(), threshold, numbers[size/2]));
+    }
+    return probe.stop();
+}
+
+// One sort of a fresh copy of the data; the copy is made before the probe starts
+inline case_result run_sort(sort_algorithm algorithm, const std::vector<int>& numbers) {
+    std::vector<int> data = numbers;
+    case_probe probe;
+    probe.start();
+    sort_numbers(data, algorithm);
+    return probe.stop();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////// Registry
+
+// One registered case; 'id' is "<ordering>/<predicate>/<workload>/<select>", with
+// "/<accumulator>" appended for anything but the volatile sink
+struct kernel_case {
+    std::string id;
+    std::string ordering;
+    std::string predicate;
+    std::string workload;
+    std::string select;
+    std::string accumulator;
+    std::string label; // e.g. "Unpredictable Complex"
+    std::function<case_result()> run;
+    std::function<void(int batch, latency_histogram&)> run_batched; // one untimed run into a latency histogram
+};
+
+inline std::string case_id(std::string_view ordering, std::string_view predicate, std::string_view workload, std::string_view select,
+                           std::string_view accumulator = volatile_accumulator::id) {
+    std::string id = std::string(ordering) + "/" + std::string(predicate) + "/" + std::string(workload) + "/" + std::string(select);
+    if (accumulator != volatile_accumulator::id)
+        id += "/" + std::string(accumulator);
+    return id;
+}
+
+// Owns one prepared copy of the data per ordering and every Ordering x Predicate x
+// Workload x Select case over it, plus the branch-free complex control per ordering
+// (registered as "<ordering>/predictable/complex/control") and the local accumulators
+// of the simple accumulator_selects cases. Every case feeds one of the tables.
+// The predicate objects must outlive the registry.
+class case_registry {
+public:
+    template<class... Predicates>
+    case_registry(const std::vector<int>& numbers, int iter, int size, volatile double& sum, const Predicates&... predicates)
+        : control_pivot_{size/2}
+    {
+        for_each_type(orderings{}, [&]<class Ordering>(std::type_identity<Ordering>) {
+            auto& data = datasets_[Ordering::id];
+            data = numbers;
+            Ordering::apply(data);
+        });
+
+        for_each_type(orderings{}, [&]<class Ordering>(std::type_identity<Ordering>) {
+            const auto& data = datasets_.at(Ordering::id);
+            (add_cases<Ordering>(data, predicates, iter, size, sum), ...);
+            add<Ordering, fixed_threshold, complex_workload, control_select>(data, control_pivot_, iter, size, sum);
+        });
+    }
+
+    case_registry(const case_registry&)            = delete;
+    case_registry& operator=(const case_registry&) = delete;
+
+    const std::vector<kernel_case>& cases() const { return cases_; }
+
+    const kernel_case& at(const std::string& id) const {
+        for (const auto& c : cases_)
+            if (c.id == id)
+                return c;
+        throw std::out_of_range("NO REGISTERED CASE " + zen::quote(id));
+    }
+
+    const std::vector<int>& dataset(const std::string& ordering) const { return datasets_.at(ordering); }
+
+private:
+    template<class Ordering, class Predicate>
+    void add_cases(const std::vector<int>& data, const Predicate& predicate, int iter, int size, volatile double& sum) {
+        for_each_type(workloads{}, [&]<class Workload>(std::type_identity<Workload>) {
+            for_each_type(selects{}, [&]<class Select>(std::type_identity<Select>) {
+                add<Ordering, Predicate, Workload, Select>(data, predicate, iter, size, sum);
+            });
+            if constexpr (std::is_same_v<Workload, simple_workload>) {
+                for_each_type(accumulator_selects{}, [&]<class Select>(std::type_identity<Select>) {
+                    for_each_type(accumulators{}, [&]<class Accumulator>(std::type_identity<Accumulator>) {
+                        if constexpr (!std::is_same_v<Accumulator, volatile_accumulator>)
+                            add<Ordering, Predicate, Workload, Select, Accumulator>(data, predicate, iter, size, sum);
+                    });
+                });
+            }
+        });
+    }
+
+    template<class Ordering, class Predicate, class Workload, class Select, class Accumulator = volatile_accumulator>
+    void add(const std::vector<int>& data, const Predicate& predicate, int iter, int size, volatile double& sum) {
+        kernel_case c;
+        c.ordering    = Ordering::id;
+        c.predicate   = Predicate::id;
+        c.workload    = Workload::id;
+        c.select      = Select::id;
+        c.accumulator = Accumulator::id;
+        c.id          = case_id(c.ordering, c.predicate, c.workload, c.select, c.accumulator);
+        if constexpr (std::is_same_v<Select, control_select>)
+            c.label = std::string(Workload::label + 1) + " Control (no branch)";
+        else
+            c.label = std::string(Predicate::label) + Workload::label;
+        c.run         = [&data, &predicate, iter, size, &sum] {
+            return run_kernel<Select, Workload>(data, predicate, iter, size, Accumulator{sum});
+        };
+        c.run_batched = [&data, &predicate, iter, size, &sum](int batch, latency_histogram& latencies) {
+            run_batched_kernel<Select, Workload>(data, predicate, iter, size, Accumulator{sum}, batch, latencies);
+        };
+        cases_.push_back(std::move(c));
+    }
+
+    fixed_threshold                         control_pivot_; // the cases keep references to it
+    std::map<std::string, std::vector<int>> datasets_;
+    std::vector<kernel_case>                cases_;
+};
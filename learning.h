@@ -0,0 +1,65 @@
+#pragma once
+
+// Learning curves: the cost of every outer iteration of a kernel, from the first pass over
+// data the predictor has never seen to the steady state. Iteration costs come from
+// run_stamped_kernel(); this finds where a phase of the run settles and what the
+// predictor spent getting there.
+
+#include <algorithm>
+#include <vector>
+#include <span>
+#include <cmath>
+#include "stats.h"
+
+// Relative distance from the steady-state cost within which an iteration counts as settled
+constexpr double learning_tolerance = 0.05;
+
+// Iterations [first, last) of a learning curve
+struct learning_phase {
+    int    first  = 0;
+    int    last   = 0;
+    int    settle = -1; // iterations after 'first' until the curve stays settled; -1 = never
+    double steady = 0;  // cost per iteration at steady state: median of the last quarter
+    double excess = 0;  // cost above steady state paid before settling
+};
+
+// Median over repetitions of every iteration; 'runs' holds one row of 'iter' costs per repetition
+inline std::vector<double> median_curve(std::span<const double> runs, int iter) {
+    const std::size_t reps = runs.size() / iter;
+    std::vector<double> curve(iter), column(reps);
+    for (int i = 0; i < iter; i++) {
+        for (std::size_t r = 0; r < reps; r++)
+            column[r] = runs[r * iter + i];
+        curve[i] = median_of(column);
+    }
+    return curve;
+}
+
+// The curve is smoothed by a 5-iteration running median before testing, so that a single
+// interrupted iteration neither settles a phase early nor keeps it from settling
+inline learning_phase analyse_phase(std::span<const double> curve, int first, int last) {
+    learning_phase phase;
+    phase.first = first;
+    phase.last  = last;
+    if (last <= first)
+        return phase;
+
+    const int tail = std::max(1, (last - first) / 4);
+    phase.steady = median_of(std::vector<double>(curve.begin() + (last - tail), curve.begin() + last));
+
+    auto smoothed = [&](int i) {
+        const int lo = std::max(first, i - 2), hi = std::min(last, i + 3);
+        return median_of(std::vector<double>(curve.begin() + lo, curve.begin() + hi));
+    };
+    int settle = last;
+    for (int i = last - 1; i >= first; i--) {
+        if (std::abs(smoothed(i) - phase.steady) > learning_tolerance * phase.steady)
+            break;
+        settle = i;
+    }
+    if (settle < last)
+        phase.settle = settle - first;
+    for (int i = first; i < settle; i++)
+        phase.excess += curve[i] - phase.steady;
+    return phase;
+}
@@ -8,278 +8,1122 @@
 #include <random>
 #include <format>
 #include "kaizen.h"
+#include "measurement.h"
+#include "kernels.h"
+#include "dataset.h"
+#include "sweep.h"
+#include "patterns.h"
+#include "results.h"
+#include "compare.h"
+#include "schedule.h"
+#include "isolation.h"
+#include "learning.h"
 #include <iomanip>
-#include <random>
+#include <array>
+#include <map>
+
+struct options {
+    int  size   = 1000;
+    int  iter   = 1000;
+    bool pregen = false; // stream unpredictable thresholds from a pre-filled buffer
+    bool tsc    = false; // time with zen::tsc_timer instead of zen::timer
+    std::uint64_t seed = 0;
+    bool seeded = false; // --seed given; otherwise a fresh seed is drawn and printed
+    bool sweep  = false; // every case at sizes around each cache level instead of one --size
+    bool entropy = false; // branchy kernel over outcome streams of rising entropy
+    bool history = false; // branchy kernel over periodic patterns of rising period
+    bool markov  = false; // branchy kernel over Markov-correlated outcomes
+    std::vector<double> markov_chain; // optional chain for --markov: 2 switch probabilities or a k x k matrix
+    sort_algorithm sort = sort_algorithm::std_sort; // how the sorted dataset is prepared
+    bool presorted = false; // branchy kernel over sorted data with rising disorder
+    bool learning  = false; // cost of every outer iteration, across a switch of outcome pattern
+    bool penalty   = false; // cycles per misprediction from a sweep of controlled miss rates
+    std::string output_format; // "json" or "csv" to also write the results to output_path
+    std::string output_path;
+    std::string compare_path;          // baseline --output json file to test this run against
+    double regression_threshold = 5;   // percent slowdown that fails the run when significant
+    bool interleave = false; // measure the registered cases in shuffled rounds instead of one after another
+    isolation isolate = isolation::none; // run every registered case in its own child process, warm or cold
+    int histogram_batch = -1; // >= 0: also record batch latencies of this many elements (0 = one pass)
+    repetition_policy repetition;
+};
+
 // Parse command-line arguments
-std::pair<int, int> process_args(int argc, char* argv[]) {
+options process_args(int argc, char* argv[]) {
     zen::cmd_args args(argv, argc);
     auto size_options = args.get_options("--size");
     auto iter_options = args.get_options("--iter");
 
+    options opts;
+    opts.pregen = args.accept("--pregen").is_present();
+    opts.sweep  = args.accept("--sweep").is_present();
+    opts.entropy = args.accept("--entropy").is_present();
+    opts.history = args.accept("--history").is_present();
+    opts.markov  = args.accept("--markov").is_present();
+    for (const auto& value : args.get_options("--markov"))
+        opts.markov_chain.push_back(std::stod(value));
+    opts.presorted = args.accept("--presorted").is_present();
+    opts.learning  = args.accept("--learning").is_present();
+    opts.penalty   = args.accept("--penalty").is_present();
+    if (args.accept("--histogram").is_present()) {
+        const auto batch = args.get_options("--histogram");
+        opts.histogram_batch = batch.empty() ? 0 : std::max(0, std::stoi(batch[0]));
+    }
+    opts.interleave = args.accept("--interleave").is_present();
+    if (auto compare = args.get_options("--compare"); !compare.empty())
+        opts.compare_path = compare[0];
+    if (auto threshold = args.get_options("--regression-threshold"); !threshold.empty())
+        opts.regression_threshold = std::stod(threshold[0]);
+    if (auto output = args.get_options("--output"); !output.empty()) {
+        opts.output_format = output[0];
+        opts.output_path   = output.size() > 1 ? output[1] : "results." + output[0];
+    }
+    if (auto sort = args.get_options("--sort"); !sort.empty() && !parse_sort_algorithm(sort[0], opts.sort))
+        zen::log("Error: --sort expects std, par, radix or counting, using std");
+    if (auto isolate = args.get_options("--isolate"); !isolate.empty()) {
+        if (!parse_isolation(isolate[0], opts.isolate))
+            zen::log("Error: --isolate expects none, warm or cold, using none");
+        else if (opts.isolate != isolation::none && !isolation_supported()) {
+            zen::log("Error: --isolate needs fork(), running every case in-process");
+            opts.isolate = isolation::none;
+        }
+    }
+    if (opts.isolate != isolation::none && opts.interleave) {
+        zen::log("Error: --interleave samples every case in one process, ignored with --isolate");
+        opts.interleave = false;
+    }
+    if (opts.sweep && opts.pregen) {
+        zen::log("Error: --pregen thresholds add about 4 MiB to every working set, ignored with --sweep");
+        opts.pregen = false;
+    }
+    if (auto timer = args.get_options("--timer"); !timer.empty())
+        opts.tsc = timer[0] == "tsc";
+    if (auto seed = args.get_options("--seed"); !seed.empty()) {
+        opts.seed   = std::stoull(seed[0]);
+        opts.seeded = true;
+    }
+
+    // Repetition: at least --reps samples, then more (up to --max-reps) until the
+    // relative half-width of the median's 95% CI drops below --target-ci
+    if (auto reps = args.get_options("--reps"); !reps.empty())
+        opts.repetition.min_reps = std::max(1, std::stoi(reps[0]));
+    if (auto target = args.get_options("--target-ci"); !target.empty())
+        opts.repetition.target_rel_ci = std::stod(target[0]);
+    if (auto max_reps = args.get_options("--max-reps"); !max_reps.empty())
+        opts.repetition.max_reps = std::stoi(max_reps[0]);
+    else if (opts.repetition.target_rel_ci <= 0)
+        opts.repetition.max_reps = opts.repetition.min_reps * 2; // headroom to replace preempted samples
+
+    // Warm-up: each case runs until --warmup-tol consecutive timings agree, for at most --warmup-cap seconds
+    if (auto tolerance = args.get_options("--warmup-tol"); !tolerance.empty())
+        opts.repetition.warmup_tolerance = std::stod(tolerance[0]);
+    if (auto cap = args.get_options("--warmup-cap"); !cap.empty())
+        opts.repetition.warmup_cap = std::stod(cap[0]);
+
     if (size_options.empty() || iter_options.empty()) {
         zen::log("Error: --size and/or --iter arguments are absent, using default 1000!");
-        return {1000, 1000};
+        return opts;
     }
-    return {std::stoi(size_options[0]), std::stoi(iter_options[0])};
+    opts.size = std::stoi(size_options[0]);
+    opts.iter = std::stoi(iter_options[0]);
+    return opts;
+}
+
+// Pretty table helpers; the TSC column only appears with --timer tsc and the
+// counter columns only when the host exposes them
+using paint = zen::color::color_string (*)(std::string_view);
+
+// Set when --histogram adds the latency columns
+bool show_latency = false;
+
+int table_width() {
+    return 129 + (case_probe::use_tsc ? 16 : 0) + (show_latency ? 5 * 13 : 0) + (shared_counters().available() ? counter_count * 16 : 0);
 }
 
-// Simulate a computationally expensive function
-double complex_process(int value) {
-    double result = std::sin(value);
-    return result;
+void print_separator() {
+    zen::print(std::format("{:-<{}}\n", "", table_width()));
 }
 
-// Warm-up function to stabilize CPU state
-void warm_up(volatile double& sum, int size) {
-    for (int i = 0; i < size; i++) {
-        sum += i;
+std::string counter_cells(const counter_values* counters) {
+    std::string cells;
+    if (!shared_counters().available())
+        return cells;
+    for (int k = 0; k < counter_count; k++) {
+        if (counters == nullptr)
+            cells += std::format(" {:>13} |", "");
+        else if (const auto& v = counters->values[k])
+            cells += std::format(" {:>13} |", *v);
+        else
+            cells += std::format(" {:>13} |", "n/a");
     }
+    return cells;
 }
 
-// Unsorted test cases
-auto run_unsorted_unpredictable(const std::vector<int>& numbers, int iter, int size, volatile double& sum) {
-    zen::timer timer;
-    timer.start();
-    for (int i = 0; i < iter; i++) {
-        for (int j = 0; j < size; j++) {
-            if (zen::random_int(0, size) > numbers[j]) {
-                sum += numbers[j];
-            }
-            else {
-                sum += numbers[size/2];
-            }
-        }
+// Batch latency percentiles in nanoseconds
+std::string latency_cells(const latency_percentiles* latency) {
+    if (!show_latency)
+        return "";
+    if (latency == nullptr || latency->count == 0)
+        return std::format(" {:>10} | {:>10} | {:>10} | {:>10} | {:>10} |", "", "", "", "", "");
+    return std::format(" {:>10.0f} | {:>10.0f} | {:>10.0f} | {:>10.0f} | {:>10.0f} |",
+        latency->p50, latency->p90, latency->p99, latency->p999, latency->max);
+}
+
+std::string tsc_cells(const double* cycles) {
+    if (!case_probe::use_tsc)
+        return "";
+    if (cycles == nullptr)
+        return std::format(" {:>13} |", "");
+    return std::format(" {:>13.0f} |", *cycles);
+}
+
+// Columns shared by every row after the unit: min, MAD, CI half-width, sample count and
+// warm-up runs ("cap" when the warm-up stopped before the timings settled)
+std::string stats_cells(const sample_summary* time, const warmup_summary* warmup = nullptr) {
+    if (time == nullptr)
+        return std::format(" {:>12} | {:>12} | {:>8} | {:>7} | {:>8} |", "", "", "", "", "");
+    std::string warm;
+    if (warmup != nullptr && warmup->runs > 0)
+        warm = warmup->converged ? std::to_string(warmup->runs) : std::format("{} cap", warmup->runs);
+    return std::format(" {:>12.6f} | {:>12.6f} | {:>7.2f}% | {:>7} | {:>8} |",
+        time->min, time->mad, time->rel_ci() * 100, std::format("{}/{}", time->count, time->count + time->rejected), warm);
+}
+
+void print_header() {
+    std::string header = std::format("| {:<36} | {:>12} | {:<9} | {:>12} | {:>12} | {:>8} | {:>7} | {:>8} |",
+        "Test Case", "Median (s)", "Unit", "Min (s)", "MAD (s)", "95% CI", "Reps", "Warm-up");
+    if (case_probe::use_tsc)
+        header += std::format(" {:>13} |", "TSC Cycles");
+    if (show_latency)
+        header += std::format(" {:>10} | {:>10} | {:>10} | {:>10} | {:>10} |", "p50 (ns)", "p90 (ns)", "p99 (ns)", "p99.9 (ns)", "Max (ns)");
+    if (shared_counters().available())
+        for (const auto* name : counter_names)
+            header += std::format(" {:>13} |", name);
+    zen::print(header + "\n");
+    print_separator();
+}
+
+void print_section(std::string_view title) {
+    zen::print(std::format("| {:^36} | {:>12} | {:<9} |{}{}{}\n", title, "", "", stats_cells(nullptr), tsc_cells(nullptr) + latency_cells(nullptr), counter_cells(nullptr)));
+}
+
+void print_result(std::string_view label, const case_report& report, paint color) {
+    zen::print(color(std::format("| {:<36} | {:>12.6f} | {:<9} |{}{}{}\n",
+        label, report.time.median, "seconds", stats_cells(&report.time, &report.warmup), tsc_cells(&report.cycles) + latency_cells(&report.latency), counter_cells(&report.counters))));
+}
+
+void print_value(std::string_view label, double value, std::string_view unit, int precision = 2) {
+    zen::print(std::format("| {:<36} | {:>12.{}f} | {:<9} |{}{}{}\n", label, value, precision, unit, stats_cells(nullptr), tsc_cells(nullptr) + latency_cells(nullptr), counter_cells(nullptr)));
+}
+
+// A row whose value cannot be computed
+void print_missing_value(std::string_view label, std::string_view unit) {
+    zen::print(std::format("| {:<36} | {:>12} | {:<9} |{}{}{}\n", label, "n/a", unit, stats_cells(nullptr), tsc_cells(nullptr) + latency_cells(nullptr), counter_cells(nullptr)));
+}
+
+double percent_difference(const case_report& slow, const case_report& fast) {
+    return ((slow.time.median - fast.time.median) / slow.time.median) * 100;
+}
+
+// Percent difference of the medians; the faster case is named only when the
+// confidence intervals do not overlap, otherwise the row says "n.s."
+void print_comparison(std::string_view label, const case_report& slow, const case_report& fast,
+                      std::string_view slow_name, std::string_view fast_name) {
+    const double diff = percent_difference(slow, fast);
+    if (!significantly_different(slow.time, fast.time)) {
+        print_value(label, diff, "% n.s.");
+        return;
     }
-    timer.stop();
-    return timer.duration<zen::timer::nsec>().count() / 1e9;
+    const auto unit = std::format("% {}", diff > 0 ? fast_name : slow_name);
+    zen::print(zen::color::yellow(std::format("| {:<36} | {:>12.2f} | {:<9} |{}{}{}\n",
+        label, diff, unit, stats_cells(nullptr), tsc_cells(nullptr) + latency_cells(nullptr), counter_cells(nullptr))));
 }
 
-auto run_unsorted_predictable(const std::vector<int>& numbers, int iter, int size, volatile double& sum) {
-    zen::timer timer;
-    timer.start();
-    for (int i = 0; i < iter; i++) {
-        for (int j = 0; j < size; j++) {
-            if (size/2 > numbers[j]) {
-                sum += numbers[j];
-            }
-            else {
-                sum += numbers[size/2];
+// Differential rows for the complex cases: each case minus the branch-free control. With
+// inline thresholds the unpredictable case also pays 'rng' seconds of draws the control
+// does not make, so those are subtracted too.
+void print_complex_overhead(const case_report& control, const case_report& predictable, const case_report& unpredictable, double rng) {
+    print_result("Complex Control (no branch)", control, zen::color::nocolor);
+    const double pred_overhead   = predictable.time.median   - control.time.median;
+    const double unpred_overhead = unpredictable.time.median - control.time.median - rng;
+    print_value("Branch Overhead Predictable", pred_overhead, "seconds", 6);
+    print_value(rng > 0 ? "Branch Overhead Unpredictable - RNG" : "Branch Overhead Unpredictable", unpred_overhead, "seconds", 6);
+    if (pred_overhead > 0 && unpred_overhead > 0) // a negative overhead is noise, not a share
+        print_value("Overhead Difference (Unpred - Pred)", (unpred_overhead - pred_overhead) / unpred_overhead * 100, "%");
+    else
+        print_missing_value("Overhead Difference (Unpred - Pred)", "%");
+}
+
+// One row of the branchy-vs-branchless table: the branchy case and its three twins
+struct branchless_row {
+    std::string                label;
+    case_report                branchy;
+    std::array<case_report, 3> twins; // mask, select, lookup
+};
+
+// Median seconds per form; the fastest form is named in the last column and only
+// counts as a win over the branchy code when their confidence intervals separate
+void print_branchless_table(const std::vector<branchless_row>& rows) {
+    constexpr std::array<const char*, 3> twin_names = {mask_select::label, cmov_select::label, lookup_select::label};
+
+    zen::print("\n", std::format("{:=^104}\n", " Branchy vs Branchless (median s) "));
+    zen::print(std::format("| {:<36} | {:>10} | {:>10} | {:>10} | {:>10} | {:<12} |\n",
+        "Test Case", "Branchy", twin_names[0], twin_names[1], twin_names[2], "Best"));
+    zen::print(std::format("{:-<104}\n", ""));
+    for (const auto& row : rows) {
+        int best = -1; // -1 = branchy
+        double best_time = row.branchy.time.median;
+        for (int k = 0; k < 3; k++) {
+            if (row.twins[k].time.median < best_time) {
+                best = k;
+                best_time = row.twins[k].time.median;
             }
         }
+        std::string verdict = best < 0 ? "Branchy" : twin_names[best];
+        if (best >= 0 && !significantly_different(row.branchy.time, row.twins[best].time))
+            verdict += " n.s.";
+        auto line = std::format("| {:<36} | {:>10.6f} | {:>10.6f} | {:>10.6f} | {:>10.6f} | {:<12} |\n",
+            row.label, row.branchy.time.median, row.twins[0].time.median, row.twins[1].time.median, row.twins[2].time.median, verdict);
+        zen::print(best < 0 ? zen::color::red(line) : zen::color::green(line));
     }
-    timer.stop();
-    return timer.duration<zen::timer::nsec>().count() / 1e9;
-}
-
-auto run_unsorted_predictable_complex(const std::vector<int>& numbers, int iter, int size, volatile double& sum) {
-    auto total_complex_time = 0.0;
-    zen::timer timer;
-    timer.start();
-    for (int i = 0; i < iter; i++) {
-        for (int j = 0; j < size; j++) {
-            if (size/2 > numbers[j]) {
-                zen::timer inner_timer;
-                inner_timer.start();
-                sum += complex_process(numbers[j]);
-                total_complex_time += inner_timer.elapsed<zen::timer::nsec>().count();
-            }
-            else {
-                zen::timer inner_timer;
-                inner_timer.start();
-                sum += complex_process(numbers[size/2]);
-                total_complex_time += inner_timer.elapsed<zen::timer::nsec>().count();
+    zen::print(std::format("{:-<104}\n", ""));
+}
+
+// Crossover summary: in how many cases of each data order a branchless form wins significantly
+void print_branchless_crossover(const std::vector<branchless_row>& rows) {
+    for (std::string_view order : {"Unsorted", "Sorted"}) {
+        int cases = 0, wins = 0;
+        for (const auto& row : rows) {
+            if (!row.label.starts_with(order))
+                continue;
+            cases++;
+            for (const auto& twin : row.twins) {
+                if (twin.time.median < row.branchy.time.median && significantly_different(twin.time, row.branchy.time)) {
+                    wins++;
+                    break;
+                }
             }
         }
+        zen::print(std::format("  {:<8} data: branchless wins {} of {} cases\n", order, wins, cases));
     }
-    timer.stop();
-    return (timer.duration<zen::timer::nsec>().count() - total_complex_time) / 1e9;
-}
-
-auto run_unsorted_unpredictable_complex(const std::vector<int>& numbers, int iter, int size, volatile double& sum) {
-    auto total_complex_time = 0.0;
-    zen::timer timer;
-    timer.start();
-    for (int i = 0; i < iter; i++) {
-        for (int j = 0; j < size; j++) {
-            if (zen::random_int(0, size) > numbers[j]) {
-                zen::timer inner_timer;
-                inner_timer.start();
-                sum += complex_process(numbers[j]);
-                total_complex_time += inner_timer.elapsed<zen::timer::nsec>().count();
-            }
-            else {
-                zen::timer inner_timer;
-                inner_timer.start();
-                sum += complex_process(numbers[size/2]);
-                total_complex_time += inner_timer.elapsed<zen::timer::nsec>().count();
-            }
-        }
+}
+
+// One row of the accumulator table: a case with the volatile sink and with 1, 2, 4 and 8 local chains
+struct accumulator_row {
+    std::string                label;
+    std::array<case_report, 5> reports; // in accumulators order
+};
+
+// Median seconds per accumulator. "Latency" is the share of the volatile time that the
+// fastest local variant removes: time spent waiting on the store-to-load chain through
+// the sink rather than on the branch. What remains with 8 chains is the branch itself.
+void print_accumulator_table(const std::vector<accumulator_row>& rows) {
+    std::array<const char*, 5> names;
+    int k = 0;
+    for_each_type(accumulators{}, [&]<class Accumulator>(std::type_identity<Accumulator>) { names[k++] = Accumulator::label; });
+
+    zen::print("\n", std::format("{:=^115}\n", " Accumulator Chains (median s) "));
+    zen::print(std::format("| {:<36} | {:>10} | {:>10} | {:>10} | {:>10} | {:>10} | {:>8} |\n",
+        "Test Case", names[0], names[1], names[2], names[3], names[4], "Latency"));
+    zen::print(std::format("{:-<115}\n", ""));
+    for (const auto& row : rows) {
+        const auto& sink = row.reports[0].time;
+        double fastest = sink.median;
+        for (std::size_t a = 1; a < row.reports.size(); a++)
+            fastest = std::min(fastest, row.reports[a].time.median);
+        const double latency = sink.median > 0 ? (sink.median - fastest) / sink.median * 100 : 0;
+        zen::print(std::format("| {:<36} | {:>10.6f} | {:>10.6f} | {:>10.6f} | {:>10.6f} | {:>10.6f} | {:>7.1f}% |\n",
+            row.label, sink.median, row.reports[1].time.median, row.reports[2].time.median, row.reports[3].time.median,
+            row.reports[4].time.median, latency));
     }
-    timer.stop();
-    return (timer.duration<zen::timer::nsec>().count() - total_complex_time) / 1e9;
+    zen::print(std::format("{:-<115}\n", ""));
 }
 
-// Sorted test cases
-auto run_sorted_unpredictable(std::vector<int>& numbers, int iter, int size, volatile auto& sum) {
-    std::sort(numbers.begin(), numbers.end());
-    zen::timer timer;
-    timer.start();
-    for (int i = 0; i < iter; i++) {
-        for (int j = 0; j < size; j++) {
-            if (zen::random_int(0, size) > numbers[j]) {
-                sum += numbers[j];
-            }
-            else {
-                sum += numbers[size/2];
-            }
+// SIMD rows for one data order, each against the branchy predictable case on the same data
+void print_simd_rows(std::string_view ordering, std::string_view order, const case_report& branchy, const std::vector<int>& numbers,
+                     const repetition_policy& policy, int iter, int size, result_set& results, volatile double& sum) {
+    zen::print(std::format("| {:<36} | {:>12.6f} | {:>9} |\n", std::format("{} Branchy Predictable", order), branchy.time.median, "1.00x"));
+    for (auto isa : simd_isas) {
+        const auto label = std::format("{} {}", order, isa_name(isa));
+        if (!isa_supported(isa)) {
+            zen::print(std::format("| {:<36} | {:>12} | {:>9} |\n", label, "unsupported", ""));
+            continue;
         }
+        const auto& simd = results.add(std::format("simd/{}/{}", ordering, isa_id(isa)),
+            {{"ordering", std::string(ordering)}, {"isa", isa_id(isa)}, {"size", size}, {"iter", iter}},
+            measure([&] { return run_simd_predictable(isa, numbers, iter, size, sum); }, policy)).report;
+        const auto speedup = std::format("{:.2f}x", branchy.time.median / simd.time.median);
+        zen::print(zen::color::green(std::format("| {:<36} | {:>12.6f} | {:>9} |\n", label, simd.time.median, speedup)));
     }
-    timer.stop();
-    return timer.duration<zen::timer::nsec>().count() / 1e9;
-}
-auto run_sorted_predictable(std::vector<int>& numbers, int iter, int size, volatile auto& sum) {
-    std::sort(numbers.begin(), numbers.end());
-    zen::timer timer;
-    timer.start();
-    for (int i = 0; i < iter; i++) {
-        for (int j = 0; j < size; j++) {
-            if (size/2 > numbers[j]) {
-                sum += numbers[j];
-            }
-            else {
-                sum += numbers[size/2];
-            }
-        }
+}
+
+// Median time of every sort algorithm on the unsorted data; the one that prepared the
+// sorted dataset is marked. Returns the median of that one.
+double print_sort_rows(const std::vector<int>& numbers, sort_algorithm used, const repetition_policy& policy, result_set& results) {
+    zen::print("\n", std::format("{:=^66}\n", " Sorting (median s) "));
+    zen::print(std::format("| {:<36} | {:>12} | {:>9} |\n", "Algorithm", "Median (s)", "Used"));
+    zen::print(std::format("{:-<66}\n", ""));
+    double used_time = 0;
+    for (auto algorithm : sort_algorithms) {
+        const auto& sorted = results.add(std::format("sort/{}", sort_id(algorithm)),
+            {{"algorithm", sort_id(algorithm)}, {"size", numbers.size()}},
+            measure([&] { return run_sort(algorithm, numbers); }, policy)).report;
+        if (algorithm == used)
+            used_time = sorted.time.median;
+        zen::print(std::format("| {:<36} | {:>12.6f} | {:>9} |\n", sort_name(algorithm), sorted.time.median, algorithm == used ? "*" : ""));
     }
-    timer.stop();
-    return timer.duration<zen::timer::nsec>().count() / 1e9;
-}
-
-auto run_sorted_predictable_complex(std::vector<int>& numbers, int iter, int size, volatile auto& sum) {
-    std::sort(numbers.begin(), numbers.end());
-    auto total_complex_time = 0.0;
-    zen::timer timer;
-    timer.start();
-    for (int i = 0; i < iter; i++) {
-        for (int j = 0; j < size; j++) {
-            if (size/2 > numbers[j]) {
-                zen::timer inner_timer;
-                inner_timer.start();
-                sum += complex_process(numbers[j]);
-                total_complex_time += inner_timer.elapsed<zen::timer::nsec>().count();
-            }
-            else {
-                zen::timer inner_timer;
-                inner_timer.start();
-                sum += complex_process(numbers[size/2]);
-                total_complex_time += inner_timer.elapsed<zen::timer::nsec>().count();
-            }
-        }
+    zen::print(std::format("{:-<66}\n", ""));
+    return used_time;
+}
+
+// Break-even --iter for "sort once, then scan sorted data" against scanning the unsorted
+// data: the sort time over what sorting saves per outer iteration. A saving whose
+// confidence intervals overlap is not counted.
+void print_break_even(std::string_view label, const case_report& unsorted, const case_report& sorted, double sort_seconds, int iter) {
+    const double saving = (unsorted.time.median - sorted.time.median) / iter;
+    std::string break_even = "never";
+    if (saving > 0 && significantly_different(unsorted.time, sorted.time))
+        break_even = std::format("{:.0f}", std::ceil(sort_seconds / saving));
+    const bool sort_wins = unsorted.time.median > sorted.time.median + sort_seconds && break_even != "never";
+    const auto line = std::format("| {:<36} | {:>12.9f} | {:>12} | {:<14} |\n",
+        label, saving, break_even, sort_wins ? "Sort + scan" : "Scan unsorted");
+    zen::print(sort_wins ? zen::color::green(line) : zen::color::red(line));
+}
+
+// Record parameters of a registered case
+parameter_list case_parameters(const kernel_case& c, int size, int iter) {
+    return {{"ordering", c.ordering}, {"predicate", c.predicate}, {"workload", c.workload}, {"select", c.select},
+            {"accumulator", c.accumulator}, {"size", size}, {"iter", iter}};
+}
+
+// --interleave: measures 'cases' in shuffled rounds from the run seed and hands each
+// report to 'record' with the run-wide positions of its samples
+template<class Record>
+schedule_log measure_cases_interleaved(const std::vector<const kernel_case*>& cases, const options& opts, Record&& record) {
+    std::vector<std::function<case_result()>> runs;
+    for (const auto* c : cases)
+        runs.push_back(c->run);
+    schedule_log log;
+    auto reports = measure_interleaved(runs, opts.repetition, opts.seed, log);
+    for (std::size_t k = 0; k < cases.size(); k++) {
+        std::string slots;
+        for (auto slot : log.slots[k])
+            slots += std::format("{}{}", slots.empty() ? "" : ";", slot);
+        record(*cases[k], std::move(reports[k]), std::move(slots));
     }
-    timer.stop();
-    return (timer.duration<zen::timer::nsec>().count() - total_complex_time) / 1e9;
-}
-
-auto run_sorted_unpredictable_complex(std::vector<int>& numbers, int iter, int size, volatile auto& sum) {
-    std::sort(numbers.begin(), numbers.end());
-    auto total_complex_time = 0.0;
-    zen::timer timer;
-    timer.start();
-    for (int i = 0; i < iter; i++) {
-        for (int j = 0; j < size; j++) {
-            if (zen::random_int(0, size) > numbers[j]) {
-                zen::timer inner_timer;
-                inner_timer.start();
-                sum += complex_process(numbers[j]);
-                total_complex_time += inner_timer.elapsed<zen::timer::nsec>().count();
-            } 
-            else {
-                zen::timer inner_timer;
-                inner_timer.start();
-                sum += complex_process(numbers[size/2]);
-                total_complex_time += inner_timer.elapsed<zen::timer::nsec>().count();
-            }
-        }
+    return log;
+}
+
+// The visiting order of every round (case numbers in registry order) and the drift
+// common to all cases: time per round relative to each case's own median
+void print_schedule(const schedule_log& log, std::size_t cases, bool rounds) {
+    zen::print(std::format("\n  Schedule: {} cases interleaved over {} rounds, drift {:+.3f}% per round\n",
+        cases, log.rounds.size(), log.drift * 100));
+    if (!rounds)
+        return;
+    for (std::size_t r = 0; r < log.rounds.size(); r++) {
+        std::string line = std::format("  Round {:>3}:", r + 1);
+        for (auto k : log.rounds[r])
+            line += std::format(" {}", k);
+        zen::print(line + "\n");
     }
-    timer.stop();
-    return (timer.duration<zen::timer::nsec>().count() - total_complex_time) / 1e9;
 }
 
-int main(int argc, char* argv[]) {
-    auto [size, iter] = process_args(argc, argv);
-    std::vector<int> numbers(size);
-    volatile double sum = 0;
+// With --histogram: --reps untimed runs of the case into one histogram of batch latencies
+void add_latency(const kernel_case& c, case_report& report, const options& opts) {
+    if (opts.histogram_batch < 0)
+        return;
+    latency_histogram latencies;
+    for (int r = 0; r < std::max(1, opts.repetition.min_reps); r++)
+        c.run_batched(opts.histogram_batch, latencies);
+    report.latency = latencies.percentiles();
+}
+
+// One registered case, in this process or, with --isolate, in a child of its own
+case_report measure_case(const kernel_case& c, const options& opts) {
+    auto report = opts.isolate == isolation::none ? measure(c.run, opts.repetition)
+                                                  : measure_isolated(c.run, opts.repetition, opts.isolate, opts.seed);
+    add_latency(c, report, opts);
+    return report;
+}
+
+// Predicate x workload pairs in the order the tables list them
+constexpr std::array<std::pair<const char*, const char*>, 4> table_cases = {{
+    {"unpredictable", "simple"}, {"predictable", "simple"}, {"predictable", "complex"}, {"unpredictable", "complex"}
+}};
 
-    // Generate test data once
-    for (int i = 0; i < size; i++) {
-        numbers[i] = zen::random_int(-size*2 , size*2);
+// Runs every registered case with the given threshold source for the unpredictable ones and prints the tables
+template<class Threshold>
+void run_experiment(const std::vector<int>& numbers, const Threshold& threshold, const options& opts, result_set& results, volatile double& sum) {
+    const int   size   = opts.size;
+    const int   iter   = opts.iter;
+    const bool  pregen = opts.pregen;
+    const auto& policy = opts.repetition;
+    const fixed_threshold pivot{size/2};
+    const case_registry registry(numbers, iter, size, sum, threshold, pivot);
+
+    // With --interleave every registered case is measured here, in shuffled rounds, and
+    // recorded in registry order (the case numbers of the printed schedule)
+    schedule_log schedule;
+    if (opts.interleave) {
+        std::vector<const kernel_case*> cases;
+        for (const auto& c : registry.cases())
+            cases.push_back(&c);
+        schedule = measure_cases_interleaved(cases, opts, [&](const kernel_case& c, case_report r, std::string slots) {
+            add_latency(c, r, opts);
+            auto parameters = case_parameters(c, size, iter);
+            parameters.emplace_back("slots", std::move(slots));
+            results.add(c.id, std::move(parameters), std::move(r));
+        });
     }
 
-    // Warm-up to stabilize CPU state
-    warm_up(sum, size);
+    // Otherwise each case is measured on first use, in table order, and recorded; every
+    // table below reads its numbers back from the records
+    auto report = [&](std::string_view ordering, std::string_view predicate, std::string_view workload, std::string_view select,
+                      std::string_view accumulator = volatile_accumulator::id) -> const case_report& {
+        const auto id = case_id(ordering, predicate, workload, select, accumulator);
+        if (const auto* record = results.find(id))
+            return record->report;
+        const auto& c = registry.at(id);
+        return results.add(id, case_parameters(c, size, iter), measure_case(c, opts)).report;
+    };
 
     // Pretty table header
     zen::print("\n" ,std::format("{:=^66}\n", " Branch Prediction Timing Results "));
-    zen::print(std::format("  Size: {:<6} | Iterations: {}\n", size, iter));
-    zen::print(std::format("| {:<36} | {:>12} | {:<9} |\n", "Test Case", "Time (s)", "Unit"));
-    zen::print(std::format("{:-<67}\n", ""));
-    zen::print(std::format("| {:^36} | {:>12} | {:<9} |\n", "Unsorted Data", "", ""));
+    zen::print(std::format("  Size: {:<6} | Iterations: {:<6} | Thresholds: {} | Reps: {}-{}\n",
+        size, iter, pregen ? "pregenerated" : "inline", policy.min_reps, std::max(policy.min_reps, policy.max_reps)));
+    zen::print(std::format("  Seed: {}{}\n", opts.seed, opts.seeded ? "" : " (random, pass --seed to repeat this run)"));
+    if (case_probe::use_tsc) {
+        const auto& cal = zen::tsc_timer::calibrate();
+        zen::print(std::format("  Timer: TSC at {:.3f} GHz, {} cycles start/stop overhead subtracted\n", cal.ghz, cal.overhead));
+    }
+    if (opts.isolate == isolation::warm)
+        zen::print("  Isolation: one child process per case\n");
+    else if (opts.isolate == isolation::cold)
+        zen::print("  Isolation: one child process per case, caches evicted and predictor scrubbed before every repetition\n");
+    if (!shared_counters().available())
+        zen::print("  Hardware counters unavailable, reporting time only\n");
+    print_header();
 
-    // Unsorted tests
-    double unpredictable_time = run_unsorted_unpredictable(numbers, iter, size, sum);
-    zen::print(zen::color::red(std::format("| {:<36} | {:>12.6f} | {:<9} |\n", "Unpredictable", unpredictable_time, "seconds")));
+    // RNG control: what the inline thresholds cost without any branch attached. Measured
+    // up front because the unpredictable complex overheads subtract it.
+    const auto& rng_only = results.add("control/rng_only", {{"size", size}, {"iter", iter}},
+        measure([&] { return run_rng_only(iter, size, sum); }, policy)).report;
 
-    double predictable_time = run_unsorted_predictable(numbers, iter, size, sum);
-    zen::print(zen::color::green(std::format("| {:<36} | {:>12.6f} | {:<9} |\n", "Predictable", predictable_time, "seconds")));
+    for_each_type(orderings{}, [&]<class Ordering>(std::type_identity<Ordering>) {
+        const std::string_view order = Ordering::id;
+        print_section(std::string(Ordering::label) + " Data");
 
-    double percent_diff_unsorted = ((unpredictable_time - predictable_time) / unpredictable_time) * 100;
-    zen::print(std::format("| {:<36} | {:>12.2f} | {:<9} |\n", "Percent Difference (Unpred - Pred)", percent_diff_unsorted, "%"));
+        const auto& unpredictable = report(order, "unpredictable", "simple", "branchy");
+        print_result("Unpredictable", unpredictable, zen::color::red);
 
-    double predictable_complex_time = run_unsorted_predictable_complex(numbers, iter, size, sum);
-    zen::print(zen::color::green(std::format("| {:<36} | {:>12.6f} | {:<9} |\n", "Predictable Complex", predictable_complex_time, "seconds")));
+        const auto& predictable = report(order, "predictable", "simple", "branchy");
+        print_result("Predictable", predictable, zen::color::green);
 
-    double unpredictable_complex_time = run_unsorted_unpredictable_complex(numbers, iter, size, sum);
-    zen::print(zen::color::red(std::format("| {:<36} | {:>12.6f} | {:<9} |\n", "Unpredictable Complex", unpredictable_complex_time, "seconds")));
+        print_comparison("Percent Difference (Unpred - Pred)", unpredictable, predictable, "Unpred", "Pred");
 
-    double percent_diff_complex_unsorted = ((unpredictable_complex_time - predictable_complex_time) / unpredictable_complex_time) * 100;
-    zen::print(std::format("| {:<36} | {:>12.2f} | {:<9} |\n", "Percent Difference (Unpred - Pred)", percent_diff_complex_unsorted, "%"));
+        const auto& predictable_complex = report(order, "predictable", "complex", "branchy");
+        print_result("Predictable Complex", predictable_complex, zen::color::green);
 
-    // Separator for sorted section
-    zen::print(std::format("{:-<67}\n", ""));
-    zen::print(std::format("| {:^36} | {:>12} | {:<9} |\n", "Sorted Data", "", ""));
+        const auto& unpredictable_complex = report(order, "unpredictable", "complex", "branchy");
+        print_result("Unpredictable Complex", unpredictable_complex, zen::color::red);
 
-    // Sorted tests (using copies to preserve original unsorted data)
-    std::vector<int> numbers_sorted = numbers; // Copy for sorted tests
-    double sorted_unpredictable_time = run_sorted_unpredictable(numbers_sorted, iter, size, sum);
-    zen::print(zen::color::red(std::format("| {:<36} | {:>12.6f} | {:<9} |\n", "Unpredictable", sorted_unpredictable_time, "seconds")));
+        print_comparison("Percent Difference (Unpred - Pred)", unpredictable_complex, predictable_complex, "Unpred", "Pred");
 
-    numbers_sorted = numbers; // Reset for next test
-    double sorted_predictable_time = run_sorted_predictable(numbers_sorted, iter, size, sum);
-    zen::print(zen::color::green(std::format("| {:<36} | {:>12.6f} | {:<9} |\n", "Predictable", sorted_predictable_time, "seconds")));
+        const auto& complex_control = report(order, "predictable", "complex", "control");
+        print_complex_overhead(complex_control, predictable_complex, unpredictable_complex, pregen ? 0 : rng_only.time.median);
+        print_separator();
+    });
 
-    double percent_diff_sorted = ((sorted_unpredictable_time - sorted_predictable_time) / sorted_unpredictable_time) * 100;
-    zen::print(std::format("| {:<36} | {:>12.2f} | {:<9} |\n", "Percent Difference (Unpred - Pred)", percent_diff_sorted, "%"));
+    // Final comparisons
+    print_section("Unsorted vs Sorted Data");
+    print_comparison("Percent Difference", report("unsorted", "predictable", "simple", "branchy"),
+                     report("sorted", "predictable", "simple", "branchy"), "Unsort", "Sorted");
+    print_comparison("Percent Difference complex", report("unsorted", "predictable", "complex", "branchy"),
+                     report("sorted", "predictable", "complex", "branchy"), "Unsort", "Sorted");
 
-    numbers_sorted = numbers; // Reset for next test
-    double sorted_predictable_complex_time = run_sorted_predictable_complex(numbers_sorted, iter, size, sum);
-    zen::print(zen::color::green(std::format("| {:<36} | {:>12.6f} | {:<9} |\n", "Predictable Complex", sorted_predictable_complex_time, "seconds")));
+    print_separator();
+    print_section("Controls");
+    print_result("RNG Only", rng_only, zen::color::nocolor);
+    if (!pregen) {
+        for_each_type(orderings{}, [&]<class Ordering>(std::type_identity<Ordering>) {
+            const auto& unpredictable = report(Ordering::id, "unpredictable", "simple", "branchy");
+            print_value(std::string(Ordering::label) + " Unpredictable - RNG Only", unpredictable.time.median - rng_only.time.median, "seconds", 6);
+        });
+    }
 
-    numbers_sorted = numbers; // Reset for next test
-    double sorted_unpredictable_complex_time = run_sorted_unpredictable_complex(numbers_sorted, iter, size, sum);
-    zen::print(zen::color::red(std::format("| {:<36} | {:>12.6f} | {:<9} |\n", "Unpredictable Complex", sorted_unpredictable_complex_time, "seconds")));
+    print_separator();
 
-    double percent_diff_complex_sorted = ((sorted_unpredictable_complex_time - sorted_predictable_complex_time) / sorted_unpredictable_complex_time) * 100;
-    zen::print(std::format("| {:<36} | {:>12.2f} | {:<9} |\n", "Percent Difference (Unpred - Pred)", percent_diff_complex_sorted, "%"));
+    // Branchless twins of every case above, on the same unsorted and sorted data
+    std::vector<branchless_row> rows;
+    for_each_type(orderings{}, [&]<class Ordering>(std::type_identity<Ordering>) {
+        for (const auto& [predicate, workload] : table_cases) {
+            const auto& branchy = report(Ordering::id, predicate, workload, "branchy");
+            rows.push_back({std::string(Ordering::label) + " " + registry.at(case_id(Ordering::id, predicate, workload, "branchy")).label, branchy, {
+                report(Ordering::id, predicate, workload, mask_select::id),
+                report(Ordering::id, predicate, workload, cmov_select::id),
+                report(Ordering::id, predicate, workload, lookup_select::id),
+            }});
+        }
+    });
+    print_branchless_table(rows);
+    print_branchless_crossover(rows);
 
-    // Final comparisons
-    zen::print(std::format("{:-<67}\n", ""));
-    zen::print(std::format("| {:^36} | {:>12}  {:<10} |\n", "Unsorted vs Sorted Data", "", ""));
-    double sorted_vs_not_sorted = ((predictable_time - sorted_predictable_time) / predictable_time) * 100;
-    zen::print(std::format("| {:<36} | {:>12.2f} | {:<9} |\n", "Percent Difference", sorted_vs_not_sorted, "%"));
+    // The simple cases again with the sink in registers: how much was latency, not the branch
+    std::vector<accumulator_row> chains;
+    for_each_type(orderings{}, [&]<class Ordering>(std::type_identity<Ordering>) {
+        for (std::string_view predicate : {"unpredictable", "predictable"}) {
+            for_each_type(accumulator_selects{}, [&]<class Select>(std::type_identity<Select>) {
+                accumulator_row row;
+                row.label = std::format("{} {} {}", Ordering::label, registry.at(case_id(Ordering::id, predicate, "simple", "branchy")).label, Select::label);
+                int a = 0;
+                for_each_type(accumulators{}, [&]<class Accumulator>(std::type_identity<Accumulator>) {
+                    row.reports[a++] = report(Ordering::id, predicate, "simple", Select::id, Accumulator::id);
+                });
+                chains.push_back(std::move(row));
+            });
+        }
+    });
+    print_accumulator_table(chains);
+
+    // Vectorised predicate evaluation, one row per instruction set
+    zen::print("\n", std::format("{:=^66}\n", " SIMD Predicate Sum (median s) "));
+    zen::print(std::format("| {:<36} | {:>12} | {:>9} |\n", "Test Case", "Median (s)", "Speedup"));
+    zen::print(std::format("{:-<66}\n", ""));
+    for_each_type(orderings{}, [&]<class Ordering>(std::type_identity<Ordering>) {
+        print_simd_rows(Ordering::id, Ordering::label, report(Ordering::id, "predictable", "simple", "branchy"),
+                        registry.dataset(Ordering::id), policy, iter, size, results, sum);
+    });
+    zen::print(std::format("{:-<66}\n", ""));
 
-    double sorted_vs_not_sorted_complex = ((predictable_complex_time - sorted_predictable_complex_time) / predictable_complex_time) * 100;
-    zen::print(std::format("| {:<36} | {:>12.2f} | {:<9} |\n", "Percent Difference complex", sorted_vs_not_sorted_complex, "%"));
+    // The sort is not part of any sorted case above; this is what it costs on its own
+    const double sort_seconds = print_sort_rows(registry.dataset(unsorted_order::id), sorted_order::algorithm, policy, results);
+    zen::print("\n", std::format("{:=^85}\n", std::format(" Sort First or Scan Unsorted? ({}, --iter {}) ", sort_name(sorted_order::algorithm), iter)));
+    zen::print(std::format("| {:<36} | {:>12} | {:>12} | {:<14} |\n", "Branchy Case", "Saved/iter", "Break-even", "At this --iter"));
+    zen::print(std::format("{:-<85}\n", ""));
+    for (const auto& [predicate, workload] : table_cases) {
+        print_break_even(registry.at(case_id(unsorted_order::id, predicate, workload, "branchy")).label,
+                         report(unsorted_order::id, predicate, workload, "branchy"),
+                         report(sorted_order::id, predicate, workload, "branchy"), sort_seconds, iter);
+    }
+    zen::print(std::format("{:-<85}\n", ""));
+
+    if (opts.interleave)
+        print_schedule(schedule, registry.cases().size(), true);
+}
 
-    zen::print(std::format("{:-<67}\n", ""));
+// One column of the sweep: every registered case at the size of 'numbers', in registry order
+struct sweep_row {
+    std::string         id;
+    std::vector<double> ns_per_element; // one per sweep point
+};
+
+template<class Threshold>
+void sweep_column(std::vector<sweep_row>& rows, std::string_view point, const std::vector<int>& numbers, const Threshold& threshold,
+                  const options& opts, int iter, result_set& results, volatile double& sum) {
+    const int size = static_cast<int>(numbers.size());
+    const fixed_threshold pivot{size/2};
+    const case_registry registry(numbers, iter, size, sum, threshold, pivot);
+    // The sweep keeps to the volatile sink; the local accumulators are a main-run table
+    std::vector<const kernel_case*> cases;
+    for (const auto& c : registry.cases())
+        if (c.accumulator == volatile_accumulator::id)
+            cases.push_back(&c);
+    if (rows.empty())
+        for (const auto* c : cases)
+            rows.push_back({c->id, {}});
+
+    auto record = [&](const kernel_case& c, case_report report, std::string slots) {
+        auto parameters = case_parameters(c, size, iter);
+        parameters.emplace_back("level", point);
+        if (!slots.empty())
+            parameters.emplace_back("slots", std::move(slots));
+        return results.add(std::format("sweep/{}/{}", point, c.id), std::move(parameters), std::move(report)).report.time.median;
+    };
+    std::size_t k = 0;
+    auto add_point = [&](const kernel_case& c, case_report report, std::string slots) {
+        const double median = record(c, std::move(report), std::move(slots));
+        rows[k++].ns_per_element.push_back(median / (static_cast<double>(iter) * size) * 1e9);
+    };
+    if (opts.interleave) {
+        const auto schedule = measure_cases_interleaved(cases, opts, add_point);
+        zen::print(std::format("        {} rounds, drift {:+.3f}% per round\n", schedule.rounds.size(), schedule.drift * 100));
+    }
+    else {
+        for (const auto* c : cases)
+            add_point(*c, measure_case(*c, opts), "");
+    }
+}
+
+// Working-set sweep: the same cases at sizes from L1 to DRAM. The number of elements
+// visited per case (--size x --iter) stays fixed, so --iter shrinks as the data grows.
+void run_sweep(const options& opts, result_set& results, volatile double& sum) {
+    const auto caches = detect_caches();
+    const auto points = sweep_points(caches);
+    const double budget = static_cast<double>(opts.size) * opts.iter;
+
+    zen::print("\n", std::format("{:=^66}\n", " Working-Set Sweep (ns per element) "));
+    std::string hierarchy;
+    for (const auto& c : caches)
+        hierarchy += std::format("L{} {} {} KiB | ", c.level, c.type, c.bytes >> 10);
+    zen::print(std::format("  Caches: {}Elements per case: {:.0f} | Seed: {}\n", hierarchy, budget, opts.seed));
+
+    std::vector<sweep_row> rows;
+    for (const auto& point : points) {
+        const int size = point.elements;
+        const int iter = std::max(1, static_cast<int>(budget / size));
+        zen::print(std::format("  {:<4}: {} elements ({} KiB) x {} iterations\n", point.name, size, size * sizeof(int) >> 10, iter));
+
+        const auto numbers = make_dataset(size, -size*2, size*2, opts.seed);
+        seed_thresholds(opts.seed);
+        sweep_column(rows, point.name, numbers, inline_threshold{size}, opts, iter, results, sum); // no --pregen, see process_args
+    }
+
+    const int width = 42 + 15 * static_cast<int>(points.size());
+    std::string header = std::format("| {:<38} |", "Case");
+    std::string sizes  = std::format("| {:<38} |", "");
+    for (const auto& point : points) {
+        header += std::format(" {:>12} |", point.name);
+        sizes  += std::format(" {:>12} |", std::format("{} KiB", point.elements * sizeof(int) >> 10));
+    }
+    zen::print("\n" + header + "\n" + sizes + "\n" + std::format("{:-<{}}\n", "", width));
+    for (const auto& row : rows) {
+        std::string line = std::format("| {:<38} |", row.id);
+        for (double ns : row.ns_per_element)
+            line += std::format(" {:>12.3f} |", ns);
+        zen::print(line + "\n");
+    }
+    zen::print(std::format("{:-<{}}\n", "", width));
+}
+
+// One point of a pattern sweep: the swept parameter, the entropy of its outcomes in
+// bits per branch, and the branchy kernel run on them
+struct pattern_point {
+    std::string parameter;
+    double      entropy;
+    case_report report;
+};
+
+// Records one point of a pattern sweep as "<family>/<parameter>" and returns it for the table
+pattern_point record_point(result_set& results, std::string_view family, std::string parameter, double entropy,
+                           case_report report, int size, int iter) {
+    results.add(std::format("{}/{}", family, parameter), {{"family", std::string(family)}, {"parameter", parameter},
+        {"entropy", entropy}, {"size", size}, {"iter", iter}}, report);
+    return {std::move(parameter), entropy, std::move(report)};
+}
+
+// Time and mispredictions per element against the swept parameter; the bar plots ns per element
+void print_pattern_table(std::string_view title, std::string_view parameter, const std::vector<pattern_point>& points, double elements) {
+    double slowest = 0;
+    for (const auto& point : points)
+        slowest = std::max(slowest, point.report.time.median);
+
+    zen::print("\n", std::format("{:=^98}\n", std::format(" {} ", title)));
+    zen::print(std::format("| {:>10} | {:>8} | {:>12} | {:>9} | {:>10} | {:<30} |\n",
+        parameter, "H (bits)", "Median (s)", "ns/elem", "Miss/elem", "ns/elem"));
+    zen::print(std::format("{:-<98}\n", ""));
+    for (const auto& point : points) {
+        const auto& r = point.report;
+        const auto misses = r.counters[counter::branch_misses];
+        const auto bar = slowest > 0 ? static_cast<std::size_t>(30 * r.time.median / slowest) : 0;
+        zen::print(std::format("| {:>10} | {:>8.3f} | {:>12.6f} | {:>9.3f} | {:>10} | {:<30} |\n",
+            point.parameter, point.entropy, r.time.median, r.time.median / elements * 1e9,
+            misses ? std::format("{:.4f}", *misses / elements) : "n/a", std::string(bar, '#')));
+    }
+    zen::print(std::format("{:-<98}\n", ""));
+}
+
+// Entropy sweep: the fraction p of coin-flip branches goes from 0 to 1 in steps of 0.1
+void run_entropy_sweep(const std::vector<int>& numbers, const options& opts, result_set& results, volatile double& sum) {
+    const int size = opts.size;
+    const int iter = opts.iter;
+    std::vector<pattern_point> points;
+    for (int k = 0; k <= 10; k++) {
+        const double p = k / 10.0;
+        const auto outcomes = mixed_outcomes(size, iter, p, opts.seed);
+        const auto report = measure([&] {
+            return run_kernel<branchy_select, simple_workload>(numbers, outcomes, iter, size, volatile_accumulator{sum});
+        }, opts.repetition);
+        points.push_back(record_point(results, "entropy", std::format("{:.1f}", p), binary_entropy(1 - p / 2), report, size, iter));
+    }
+    print_pattern_table("Branch Entropy Sweep (p = random fraction)", "p", points, static_cast<double>(size) * iter);
+    if (!shared_counters().available())
+        zen::print("  Hardware counters unavailable, misprediction rate not measured\n");
+}
+
+// History-length sweep: random patterns of period 2 to 64K repeated back to back, then a
+// row of 'size' outcomes replayed every outer iteration and the never-repeating stream.
+// The knee is the first period whose cost gets halfway from the shortest period to the
+// random stream; the predictor memorises patterns up to about the period before it.
+void run_history_sweep(const std::vector<int>& numbers, const options& opts, result_set& results, volatile double& sum) {
+    const int size = opts.size;
+    const int iter = opts.iter;
+    auto run = [&](const auto& pattern) {
+        return measure([&] {
+            return run_kernel<branchy_select, simple_workload>(numbers, pattern, iter, size, volatile_accumulator{sum});
+        }, opts.repetition);
+    };
+
+    std::vector<pattern_point> points;
+    for (int period = 2; period <= 1 << 16; period *= 2) {
+        const periodic_pattern pattern(size, period, opts.seed);
+        points.push_back(record_point(results, "history", std::to_string(period), binary_entropy(pattern.taken_rate()), run(pattern), size, iter));
+    }
+    const auto replayed = replayed_outcomes(size, opts.seed);
+    points.push_back(record_point(results, "history", "replay", binary_entropy(replayed.taken_rate()), run(replayed), size, iter));
+    const auto random = mixed_outcomes(size, iter, 1.0, opts.seed);
+    points.push_back(record_point(results, "history", "random", binary_entropy(random.taken_rate()), run(random), size, iter));
+
+    const double elements = static_cast<double>(size) * iter;
+    print_pattern_table(std::format("Predictor History Sweep (replay = {} outcomes per iter)", size), "Period", points, elements);
+
+    // Mispredictions per element when counted, time per element otherwise
+    const bool counted = points.front().report.counters[counter::branch_misses].has_value();
+    auto cost = [&](const pattern_point& point) {
+        return counted ? static_cast<double>(*point.report.counters[counter::branch_misses]) : point.report.time.median;
+    };
+    const double low  = cost(points.front());
+    const double high = cost(points.back());
+    const std::size_t periods = points.size() - 2; // without the replay and random rows
+    std::size_t knee = 0;
+    while (knee < periods && cost(points[knee]) < low + (high - low) / 2)
+        knee++;
+    if (knee == 0 || knee == periods)
+        zen::print(std::format("  No knee between period 2 and 65536 ({})\n", counted ? "branch misses" : "time"));
+    else
+        zen::print(std::format("  Knee at period {} ({}): patterns up to about {} outcomes are learned\n",
+            points[knee].parameter, counted ? "branch misses" : "time", points[knee - 1].parameter));
+}
+
+// Markov sweep: symmetric two-state chains from long runs (q small) through the coin
+// flip (q = 0.5) to near-alternation, all 50/50 biased; then the chain given on the
+// command line, if any. Misprediction tracks the conditional entropy, not the bias.
+void run_markov_sweep(const std::vector<int>& numbers, const options& opts, result_set& results, volatile double& sum) {
+    const int size = opts.size;
+    const int iter = opts.iter;
+    auto point = [&](std::string parameter, const markov_chain& chain) {
+        const auto outcomes = markov_outcomes(size, iter, chain, opts.seed);
+        const auto report = measure([&] {
+            return run_kernel<branchy_select, simple_workload>(numbers, outcomes, iter, size, volatile_accumulator{sum});
+        }, opts.repetition);
+        return record_point(results, "markov", std::move(parameter), chain.conditional_entropy(), report, size, iter);
+    };
+
+    std::vector<pattern_point> points;
+    for (double q : {0.01, 0.05, 0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.7, 0.8, 0.9, 0.95, 0.99})
+        points.push_back(point(std::format("q={}", q), markov_chain::two_state(q, q)));
+
+    const auto& values = opts.markov_chain;
+    const int k = static_cast<int>(std::lround(std::sqrt(values.size())));
+    if (values.size() == 2) {
+        points.push_back(point("custom", markov_chain::two_state(values[0], values[1])));
+    }
+    else if (k >= 2 && static_cast<std::size_t>(k * k) == values.size()) {
+        markov_chain chain{k, values};
+        chain.normalise();
+        points.push_back(point(std::format("{}-state", k), chain));
+    }
+    else if (!values.empty()) {
+        zen::log("Error: --markov takes 2 switch probabilities or a k x k transition matrix, ignoring", values.size(), "values");
+    }
+    print_pattern_table("Markov-Correlated Outcomes (H = conditional entropy)", "Chain", points, static_cast<double>(size) * iter);
+}
+
+// Presortedness sweep: the predictable branchy case on sorted data with k% disorder of
+// each kind, against the fully sorted and the unsorted data. "Advantage kept" is the
+// share of the sorted-vs-unsorted gap that the nearly-sorted input still enjoys.
+void run_presorted_sweep(const std::vector<int>& numbers, const options& opts, result_set& results, volatile double& sum) {
+    const int size = opts.size;
+    const int iter = opts.iter;
+    const fixed_threshold threshold{size/2};
+    auto run = [&](const std::vector<int>& data, std::string kind, double percent) -> const case_report& {
+        const auto id = percent > 0 ? std::format("presorted/{}/{}", kind, percent) : "presorted/" + kind;
+        return results.add(id, {{"disorder", kind}, {"percent", percent}, {"size", size}, {"iter", iter}},
+            measure([&] {
+                return run_kernel<branchy_select, simple_workload>(data, threshold, iter, size, volatile_accumulator{sum});
+            }, opts.repetition)).report;
+    };
+
+    std::vector<int> sorted = numbers;
+    sort_numbers(sorted, opts.sort);
+    const auto& unsorted_report = run(numbers, "unsorted", 0);
+    const auto& sorted_report   = run(sorted, "sorted", 0);
+    const double gap = unsorted_report.time.median - sorted_report.time.median;
+
+    zen::print("\n", std::format("{:=^81}\n", " Presortedness Sweep (Predictable, branchy) "));
+    zen::print(std::format("| {:<26} | {:>12} | {:>9} | {:>10} | {:<10} |\n", "Input", "Median (s)", "ns/elem", "Miss/elem", "Adv. kept"));
+    zen::print(std::format("{:-<81}\n", ""));
+    const double elements = static_cast<double>(size) * iter;
+    auto row = [&](std::string_view label, const case_report& r) {
+        const auto misses = r.counters[counter::branch_misses];
+        const auto kept = gap > 0 ? std::format("{:.1f}%", (unsorted_report.time.median - r.time.median) / gap * 100) : "n/a"; // no advantage to keep
+        zen::print(std::format("| {:<26} | {:>12.6f} | {:>9.3f} | {:>10} | {:>10} |\n",
+            label, r.time.median, r.time.median / elements * 1e9, misses ? std::format("{:.4f}", *misses / elements) : "n/a", kept));
+    };
+    row("Sorted", sorted_report);
+    for (auto kind : {disorder::swaps, disorder::block_shuffle, disorder::reversed_runs}) {
+        for (double percent : {0.5, 1.0, 2.0, 5.0, 10.0, 25.0, 50.0, 100.0}) {
+            std::vector<int> data = sorted;
+            apply_disorder(data, kind, percent / 100, opts.seed);
+            row(std::format("{} {}%", disorder_name(kind), percent), run(data, disorder_id(kind), percent));
+        }
+    }
+    row("Unsorted", unsorted_report);
+    zen::print(std::format("{:-<81}\n", ""));
+    if (gap <= 0 || !significantly_different(unsorted_report.time, sorted_report.time))
+        zen::print("  Sorted and unsorted data do not differ significantly at this --size/--iter\n");
+}
+
+// Learning curve: the branchy kernel over one replayed random row of outcomes, switched
+// to a different row halfway through. Every repetition starts from a scrubbed predictor
+// and stamps the counter after each outer iteration; the curve is the median over the
+// repetitions. Eight local chains keep the sink's latency from flattening the curve.
+void run_learning_curve(const std::vector<int>& numbers, const options& opts, result_set& results, volatile double& sum) {
+    const int size = opts.size;
+    const int iter = std::max(2, opts.iter);
+    const int reps = std::max(1, opts.repetition.min_reps);
+    const pattern_switch outcomes(replayed_outcomes(size, opts.seed), replayed_outcomes(size, opts.seed + 1), iter / 2);
+    const double ghz = zen::tsc_timer::calibrate().ghz;
+
+    // Everything the loop writes is allocated here
+    std::vector<std::uint64_t> stamps(std::size_t(iter) + 1);
+    std::vector<double>        runs(std::size_t(reps) * iter);
+    for (int r = 0; r < reps; r++) {
+        scrub_predictor(opts.seed + r);
+        run_stamped_kernel<branchy_select, simple_workload>(numbers, outcomes, iter, size, local_accumulator<8>{sum}, stamps);
+        for (int i = 0; i < iter; i++)
+            runs[std::size_t(r) * iter + i] = static_cast<double>(stamps[i + 1] - stamps[i]);
+    }
+    const auto curve = median_curve(runs, iter);
+    const std::array<learning_phase, 2> phases = {analyse_phase(curve, 0, outcomes.at()), analyse_phase(curve, outcomes.at(), iter)};
+    const char* unit = zen::tsc_timer::supported() ? "cycles" : "ns";
+
+    // Iterations 0-7 of each phase, then every power of two and 1.5 times it
+    double slowest = 0;
+    for (double c : curve)
+        slowest = std::max(slowest, c);
+    zen::print("\n", std::format("{:=^82}\n", std::format(" Learning Curve ({} per element, switch at iteration {}) ", unit, outcomes.at())));
+    zen::print(std::format("| {:>9} | {:<9} | {:>12} | {:<40} |\n", "Iteration", "Phase", std::format("{}/elem", unit), ""));
+    zen::print(std::format("{:-<82}\n", ""));
+    for (const auto& phase : phases) {
+        for (int step = 0; phase.first + step < phase.last; step = step < 8 ? step + 1 : (step & (step - 1)) == 0 ? step + step / 2 : (step / 3) * 4) {
+            const double c = curve[phase.first + step];
+            const auto bar = slowest > 0 ? static_cast<std::size_t>(40 * c / slowest) : 0;
+            const auto line = std::format("| {:>9} | {:<9} | {:>12.3f} | {:<40} |\n", phase.first + step,
+                phase.first == 0 ? "learn" : "re-learn", c / size, std::string(bar, '#'));
+            const bool settled = phase.settle >= 0 && step >= phase.settle;
+            zen::print(settled ? zen::color::green(line) : zen::color::red(line));
+        }
+    }
+    zen::print(std::format("{:-<82}\n", ""));
+
+    for (const auto& phase : phases) {
+        const bool learn = phase.first == 0;
+        const auto name  = learn ? "learn" : "relearn";
+        std::vector<double> seconds;
+        for (int r = 0; r < reps; r++) {
+            double total = 0;
+            for (int i = phase.first; i < phase.last; i++)
+                total += runs[std::size_t(r) * iter + i];
+            seconds.push_back(total / ghz / 1e9);
+        }
+        std::string points;
+        for (int i = phase.first; i < phase.last; i++)
+            points += std::format("{}{:.0f}", points.empty() ? "" : ";", curve[i]);
+        case_report report;
+        report.time = summarize(std::move(seconds));
+        results.add(std::format("learning/{}", name), {{"phase", name}, {"first", phase.first}, {"last", phase.last},
+            {"settle_iterations", phase.settle}, {"steady_per_element", phase.steady / size},
+            {"excess", phase.excess}, {"unit", unit}, {"size", size}, {"reps", reps},
+            {"curve", points}}, std::move(report));
+
+        const auto what = learn ? "Learning" : "Re-learning after the switch";
+        if (phase.settle < 0)
+            zen::print(zen::color::yellow(std::format("  {}: not settled within {:.0f}% by iteration {}\n", what, learning_tolerance * 100, phase.last)));
+        else
+            zen::print(std::format("  {}: steady after {} iterations at {:.3f} {}/element, {:.0f} {} ({:.1f} us) above steady state\n",
+                what, phase.settle, phase.steady / size, unit, phase.excess, unit, phase.excess / ghz / 1e3));
+    }
+}
+
+// Misprediction penalty: the branchy kernel over mixed outcomes with a random fraction p
+// from 0 to 1, regressed as cycles per element against mispredictions per element.
+// With counters both come from the PMU (core cycles, counted misses). Without, cycles
+// are TSC reference cycles and the miss rate is the one the stream was built with: half
+// the coin flips, p/2. The stream does not repeat within 2^20 outcomes, so the predictor
+// cannot memorise them. Eight local chains keep the sink's latency out of the slope.
+void run_penalty_estimate(const std::vector<int>& numbers, const options& opts, result_set& results, volatile double& sum) {
+    const int size = opts.size;
+    const int iter = opts.iter;
+    const double elements = static_cast<double>(size) * iter;
+    const double ghz      = zen::tsc_timer::calibrate().ghz;
+    bool measured = shared_counters().available(); // until a point lacks either counter
+
+    std::vector<double> miss_rates, costs;
+    std::vector<pattern_point> points;
+    for (int k = 0; k <= 10; k++) {
+        const double p = k / 10.0;
+        const auto outcomes = mixed_outcomes(size, iter, p, opts.seed);
+        const auto report = measure([&] {
+            return run_kernel<branchy_select, simple_workload>(numbers, outcomes, iter, size, local_accumulator<8>{sum});
+        }, opts.repetition);
+        points.push_back(record_point(results, "penalty", std::format("{:.1f}", p), binary_entropy(1 - p / 2), report, size, iter));
+
+        const auto misses = report.counters[counter::branch_misses];
+        const auto cycles = report.counters[counter::cycles];
+        measured = measured && misses && cycles;
+        miss_rates.push_back(measured ? *misses / elements : p / 2);
+        costs.push_back(measured ? *cycles / elements : report.time.median * ghz * 1e9 / elements);
+    }
+    if (!measured) { // one source for every point
+        for (int k = 0; k <= 10; k++) {
+            miss_rates[k] = k / 20.0;
+            costs[k]      = points[k].report.time.median * ghz * 1e9 / elements;
+        }
+    }
+    print_pattern_table("Misprediction Penalty Sweep (p = random fraction)", "p", points, elements);
+
+    const auto fit  = fit_line(miss_rates, costs);
+    const auto unit = measured ? "core cycles" : zen::tsc_timer::supported() ? "TSC reference cycles" : "ns";
+    zen::print(std::format("  Fit over {} points, {} against {} misses per element (R^2 = {:.4f})\n",
+        fit.points, unit, measured ? "counted" : "expected (p/2)", fit.r2));
+    zen::print(zen::color::green(std::format("  Misprediction penalty: {:.2f} {} per miss (95% CI {:.2f} to {:.2f}), {:.2f} per element without misses\n",
+        fit.slope, unit, fit.slope_low, fit.slope_high, fit.intercept)));
+    if (!measured)
+        zen::print("  Hardware counters unavailable: misses are the expected rate of the stream, the cycles scaled from time\n");
+
+    results.settings.emplace_back("penalty_cycles_per_miss", fit.slope);
+    results.settings.emplace_back("penalty_ci_low", fit.slope_low);
+    results.settings.emplace_back("penalty_ci_high", fit.slope_high);
+    results.settings.emplace_back("penalty_base_per_element", fit.intercept);
+    results.settings.emplace_back("penalty_r2", fit.r2);
+    results.settings.emplace_back("penalty_source", measured ? "counters" : "expected_rate");
+}
+
+// Diff against a baseline run, case by case; returns the number of regressions
+int print_baseline_comparison(const std::vector<case_change>& changes, double threshold, std::size_t unmatched) {
+    zen::print("\n", std::format("{:=^113}\n", std::format(" Baseline Comparison (Mann-Whitney U, regression > {}%) ", threshold)));
+    zen::print(std::format("| {:<50} | {:>12} | {:>12} | {:>8} | {:>7} | {:<8} |\n", "Case", "Baseline (s)", "Current (s)", "Change", "p", "Verdict"));
+    zen::print(std::format("{:-<113}\n", ""));
+    int regressions = 0;
+    for (const auto& c : changes) {
+        const char* verdict = !c.significant ? "n.s." : c.regression ? "REGRESS" : c.percent > 0 ? "Slower" : "Faster";
+        const auto line = std::format("| {:<50} | {:>12.6f} | {:>12.6f} | {:>+7.2f}% | {:>7.4f} | {:<8} |\n",
+            c.id, c.baseline, c.current, c.percent, c.p, verdict);
+        if (c.regression) {
+            regressions++;
+            zen::print(zen::color::red(line));
+        }
+        else if (c.significant) {
+            zen::print(c.percent > 0 ? zen::color::yellow(line) : zen::color::green(line));
+        }
+        else {
+            zen::print(line);
+        }
+    }
+    zen::print(std::format("{:-<113}\n", ""));
+    zen::print(std::format("  {} cases compared, {} not in the baseline, {} regressions\n", changes.size(), unmatched, regressions));
+    return regressions;
+}
+
+// One line on the warm-ups of the whole run, naming the cases that never settled
+void print_warmup_summary(const result_set& results, const repetition_policy& policy) {
+    if (policy.warmup_tolerance <= 0)
+        return;
+    std::vector<double> runs;
+    std::vector<std::string> capped;
+    double seconds = 0;
+    for (const auto& r : results.records()) {
+        const auto& w = r.report.warmup;
+        if (w.runs == 0)
+            continue;
+        runs.push_back(w.runs);
+        seconds += w.seconds;
+        if (!w.converged)
+            capped.push_back(std::format("{} ({:.1f}%)", r.id, w.spread * 100));
+    }
+    if (runs.empty())
+        return;
+    zen::print(std::format("\n  Warm-up: {} of {} cases settled within {:.1f}% over {} runs, median {:.0f} runs per case, {:.2f} s in total\n",
+        runs.size() - capped.size(), runs.size(), policy.warmup_tolerance * 100, std::max(2, policy.warmup_window), median_of(runs), seconds));
+    for (const auto& id : capped)
+        zen::print(zen::color::yellow(std::format("  Warm-up hit the {} s cap: {}\n", policy.warmup_cap, id)));
+}
+
+int main(int argc, char* argv[]) {
+    auto opts = process_args(argc, argv);
+    const int size = opts.size;
+    const int iter = opts.iter;
+    volatile double sum = 0;
+    if (!opts.seeded)
+        opts.seed = random_seed();
+
+    // Calibrate before any case so that no timed region pays for it
+    case_probe::use_tsc = opts.tsc;
+    show_latency = opts.histogram_batch >= 0;
+    sorted_order::algorithm = opts.sort;
+    if (opts.tsc)
+        zen::tsc_timer::calibrate();
+
+    result_set results;
+    results.settings = {
+        {"mode", opts.sweep ? "sweep" : opts.entropy ? "entropy" : opts.history ? "history" : opts.markov ? "markov" : opts.presorted ? "presorted" : opts.learning ? "learning" : opts.penalty ? "penalty" : "cases"},
+        {"size", size}, {"iter", iter}, {"seed", std::to_string(opts.seed)},
+        {"thresholds", opts.pregen ? "pregenerated" : "inline"}, {"timer", opts.tsc ? "tsc" : "steady_clock"},
+        {"min_reps", opts.repetition.min_reps}, {"max_reps", opts.repetition.max_reps},
+        {"target_ci", opts.repetition.target_rel_ci}, {"sort", sort_id(opts.sort)},
+        {"warmup_tolerance", opts.repetition.warmup_tolerance}, {"warmup_cap", opts.repetition.warmup_cap},
+        {"schedule", opts.interleave ? "interleaved" : "sequential"}, {"isolation", isolation_id(opts.isolate)},
+        {"histogram_batch", opts.histogram_batch < 0 ? parameter_value("off") : parameter_value(opts.histogram_batch)},
+    };
+
+    if (opts.sweep) {
+        run_sweep(opts, results, sum);
+    }
+    else {
+        // Generate test data once, in parallel; the result depends only on the seed
+        const std::vector<int> numbers = make_dataset(size, -size*2, size*2, opts.seed);
+        seed_thresholds(opts.seed);
+
+        if (opts.entropy)
+            run_entropy_sweep(numbers, opts, results, sum);
+        else if (opts.history)
+            run_history_sweep(numbers, opts, results, sum);
+        else if (opts.markov)
+            run_markov_sweep(numbers, opts, results, sum);
+        else if (opts.presorted)
+            run_presorted_sweep(numbers, opts, results, sum);
+        else if (opts.learning)
+            run_learning_curve(numbers, opts, results, sum);
+        else if (opts.penalty)
+            run_penalty_estimate(numbers, opts, results, sum);
+        else if (opts.pregen)
+            run_experiment(numbers, threshold_stream(size, iter), opts, results, sum); // filled here, before any timer starts
+        else
+            run_experiment(numbers, inline_threshold{size}, opts, results, sum);
+    }
+
+    print_warmup_summary(results, opts.repetition);
+
+    if (!opts.output_format.empty()) {
+        if (write_results(results, opts.output_format, opts.output_path))
+            zen::print(std::format("  Results written to {}\n", opts.output_path));
+        else
+            zen::log("Error: could not write", zen::quote(opts.output_path), "as", opts.output_format, "(--output expects json or csv)");
+    }
+
+    // Exit code 1 when any case regressed beyond the threshold, 2 when the baseline is unusable
+    if (!opts.compare_path.empty()) {
+        try {
+            const auto baseline = load_baseline(opts.compare_path, results.settings);
+            const auto changes  = compare_cases(baseline, results, opts.regression_threshold);
+            if (print_baseline_comparison(changes, opts.regression_threshold, results.records().size() - changes.size()) > 0)
+                return 1;
+        }
+        catch (const std::exception& e) {
+            zen::log("Error:", e.what());
+            return 2;
+        }
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+// Measurement scaffolding shared by every kernel: a probe that brackets one run with
+// the counter group and the selected timer, and the repetition wrapper that turns
+// runs into a case report.
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <cmath>
+#include "kaizen.h"
+#include "perf_counters.h"
+#include "stats.h"
+#include "histogram.h"
+
+// Compiler barriers for kernels whose results live in registers. do_not_optimize() makes
+// the compiler treat 'value' as read (and possibly modified) at that point, so its
+// computation cannot be dropped or hoisted; clobber_memory() forces pending stores out.
+// MSVC has no inline asm on x64, so there the value escapes through a volatile pointer.
+#if defined(__GNUC__) || defined(__clang__)
+template<class T>
+inline void do_not_optimize(T& value) {
+    asm volatile("" : "+r,m"(value) : : "memory");
+}
+
+template<class T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void clobber_memory() {
+    asm volatile("" : : : "memory");
+}
+
+// An empty asm statement with no operands: free at run time, but a block containing it
+// is not merged with its sibling or turned into a conditional move
+inline void keep_branch() {
+    asm volatile("");
+}
+#else
+#include <intrin.h>
+
+template<class T>
+inline void do_not_optimize(const T& value) {
+    static const volatile void* sink;
+    sink = &value;
+    _ReadWriteBarrier();
+}
+
+inline void clobber_memory() {
+    _ReadWriteBarrier();
+}
+
+inline void keep_branch() {}
+#endif
+
+// Wall-clock time plus hardware counters (when the host exposes them) of one kernel run
+struct case_result {
+    double         seconds = 0;
+    double         cycles  = 0; // TSC reference cycles, only with the TSC timer backend
+    counter_values counters;
+};
+
+// One counter group for the whole process, opened before any kernel runs
+inline perf_counters& shared_counters() {
+    static perf_counters counters;
+    return counters;
+}
+
+// Brackets a kernel with the counter group and a timer: zen::timer by default, or the
+// calibrated zen::tsc_timer with --timer tsc. Counters are enabled outside the timer
+// so that the ioctl calls do not show up in the measured time.
+class case_probe {
+public:
+    static inline bool use_tsc = false;
+
+    void start() {
+        shared_counters().start();
+        if (use_tsc)
+            tsc_.start();
+        else
+            timer_.start();
+    }
+
+    case_result stop() {
+        case_result result;
+        if (use_tsc) {
+            tsc_.stop();
+            const double ghz = zen::tsc_timer::calibrate().ghz;
+            result.cycles  = static_cast<double>(tsc_.cycles());
+            result.seconds = result.cycles / ghz / 1e9;
+        }
+        else {
+            timer_.stop();
+            result.seconds = timer_.duration<zen::timer::nsec>().count() / 1e9;
+        }
+        shared_counters().stop();
+        result.counters = shared_counters().read();
+        return result;
+    }
+
+private:
+    zen::timer     timer_;
+    zen::tsc_timer tsc_;
+};
+
+// Times the batches of one run with the probe's timer backend, in nanoseconds and
+// without the counter group
+class batch_timer {
+public:
+    void start() {
+        if (case_probe::use_tsc)
+            tsc_.start();
+        else
+            timer_.start();
+    }
+
+    std::uint64_t stop() {
+        if (case_probe::use_tsc)
+            return static_cast<std::uint64_t>(tsc_.stop().duration<zen::timer::nsec>().count());
+        timer_.stop();
+        return static_cast<std::uint64_t>(timer_.duration<zen::timer::nsec>().count());
+    }
+
+private:
+    zen::timer     timer_;
+    zen::tsc_timer tsc_;
+};
+
+// All repetitions of one case: time statistics plus the counters of the run closest to
+// the median, how the warm-up before them went and, with --histogram, the batch latencies
+struct case_report {
+    sample_summary      time;
+    double              cycles = 0;
+    counter_values      counters;
+    warmup_summary      warmup;
+    latency_percentiles latency;
+};
+
+// One case being measured: the warm-up before its first sample, then one sample per
+// call until the policy is satisfied. measure() drives one in a row; the interleaved
+// schedule drives several in turn.
+template<class Run>
+class case_sampler {
+public:
+    case_sampler(Run run, const repetition_policy& policy) : run_(std::forward<Run>(run)), policy_(policy), collector_(policy) {}
+
+    // Seconds of the sample taken. 'prepare' runs first, outside the sample and its
+    // preemption check, e.g. to put the machine into a known state.
+    template<class Prepare>
+    double sample(Prepare&& prepare) {
+        if (!warmed_up_) {
+            warmup_    = warm_up_samples([&] { return run_().seconds; }, policy_);
+            warmed_up_ = true;
+        }
+        prepare();
+        return collector_.take([&] {
+            results_.push_back(run_());
+            return results_.back().seconds;
+        });
+    }
+
+    double sample() { return sample([] {}); }
+
+    bool done() const { return collector_.done(); }
+
+    case_report report() const {
+        const auto time = collector_.summary();
+        auto closest = std::min_element(results_.begin(), results_.end(), [&](const auto& a, const auto& b) {
+            return std::abs(a.seconds - time.median) < std::abs(b.seconds - time.median);
+        });
+        return {time, closest->cycles, closest->counters, warmup_, {}}; // latency is added by the histogram run
+    }
+
+private:
+    Run                      run_;
+    repetition_policy        policy_;
+    sample_collector         collector_;
+    warmup_summary           warmup_;
+    bool                     warmed_up_ = false;
+    std::vector<case_result> results_;
+};
+
+template<class Run, class Prepare>
+case_report measure(Run&& run, const repetition_policy& policy, Prepare&& prepare) {
+    case_sampler<Run&> sampler(run, policy);
+    while (!sampler.done())
+        sampler.sample(prepare);
+    return sampler.report();
+}
+
+template<class Run>
+case_report measure(Run&& run, const repetition_policy& policy) {
+    return measure(run, policy, [] {});
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+// Branch outcome streams with controlled statistics. Each stream is a Predicate for
+// run_kernel(): it hands out a threshold above every element where the branch is to
+// be taken and one below every element where it is not, so the branch follows the
+// stream whatever the data. All streams are generated before any timer starts.
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <cmath>
+#include "dataset.h"
+
+constexpr int taken_threshold     = INT_MAX;
+constexpr int not_taken_threshold = INT_MIN;
+
+// Engine stream of the run seed reserved for outcome patterns
+constexpr std::uint64_t pattern_stream_id = ~std::uint64_t(1);
+
+// Entropy in bits of a branch taken with probability q
+inline double binary_entropy(double q) {
+    if (q <= 0 || q >= 1) return 0;
+    return -q * std::log2(q) - (1 - q) * std::log2(1 - q);
+}
+
+// Uniform double in [0, 1) from the top 53 bits of one draw
+template<class Engine>
+double unit_random(Engine& engine) {
+    return static_cast<double>(engine() >> 11) * 0x1p-53;
+}
+
+// One outcome per element for 'rows' outer iterations, drawn in order from 'next'.
+// Rows repeat every 'rows' iterations, like threshold_stream.
+class outcome_stream {
+public:
+    static constexpr const char* id    = "pattern";
+    static constexpr const char* label = "Pattern";
+
+    template<class Next>
+    outcome_stream(int size, int rows, Next&& next)
+        : size_(size), rows_(std::max(1, rows)), data_(std::size_t(size) * rows_)
+    {
+        for (auto& t : data_)
+            t = next() ? taken_threshold : not_taken_threshold;
+    }
+
+    int operator()(int i, int j) const { return data_[std::size_t(i % rows_) * size_ + j]; }
+
+    // Fraction of taken outcomes actually generated
+    double taken_rate() const {
+        return data_.empty() ? 0 : static_cast<double>(std::count(data_.begin(), data_.end(), taken_threshold)) / data_.size();
+    }
+
+private:
+    int              size_;
+    int              rows_;
+    std::vector<int> data_;
+};
+
+// A fraction p of the branches is decided by a fair coin, the rest are always taken.
+// p = 0 is the perfectly biased branch, p = 1 the fully random one; the outcome
+// entropy is binary_entropy(1 - p/2).
+inline outcome_stream mixed_outcomes(int size, int iter, double p, std::uint64_t seed) {
+    auto engine = stream_engine(seed, pattern_stream_id);
+    return outcome_stream(size, stream_rows(size, iter), [&] {
+        return unit_random(engine) >= p || (engine() & 1);
+    });
+}
+
+// A random outcome sequence of power-of-two length 'period', repeated back to back over
+// the whole run (the flattened index i * size + j wraps at the period). Once the period
+// exceeds what the predictor can hold in its history, mispredictions jump.
+class periodic_pattern {
+public:
+    static constexpr const char* id    = "periodic";
+    static constexpr const char* label = "Periodic";
+
+    periodic_pattern(int size, int period, std::uint64_t seed)
+        : size_(size), mask_(static_cast<std::size_t>(period) - 1), data_(period)
+    {
+        auto engine = stream_engine(seed, pattern_stream_id);
+        for (auto& t : data_)
+            t = (engine() & 1) ? taken_threshold : not_taken_threshold;
+    }
+
+    int operator()(int i, int j) const { return data_[(std::size_t(i) * size_ + j) & mask_]; }
+
+    double taken_rate() const {
+        return static_cast<double>(std::count(data_.begin(), data_.end(), taken_threshold)) / data_.size();
+    }
+
+private:
+    int              size_;
+    std::size_t      mask_;
+    std::vector<int> data_;
+};
+
+// One random row of 'size' coin flips, replayed identically in every outer iteration
+inline outcome_stream replayed_outcomes(int size, std::uint64_t seed) {
+    auto engine = stream_engine(seed, pattern_stream_id);
+    return outcome_stream(size, 1, [&] { return (engine() & 1) != 0; });
+}
+
+// A k-state Markov chain over branch outcomes. 'transitions' is the row-major k x k
+// matrix of P(next state | state), normalise()d before use; state s emits 'taken' when s < k/2. Two states with
+// a switch probability q are the classic bursty branch: q = 0.5 is a coin flip, small q
+// gives long runs and large q near-alternation, all with the same 50/50 bias.
+struct markov_chain {
+    int                 states = 2;
+    std::vector<double> transitions;
+
+    static markov_chain two_state(double leave_taken, double leave_not_taken) {
+        return {2, {1 - leave_taken, leave_taken, leave_not_taken, 1 - leave_not_taken}};
+    }
+
+    bool emits_taken(int s) const { return s < states / 2; }
+
+    // Scales every row to sum to one; an all-zero row becomes uniform
+    void normalise() {
+        for (int i = 0; i < states; i++) {
+            double total = 0;
+            for (int j = 0; j < states; j++)
+                total += p(i, j);
+            for (int j = 0; j < states; j++)
+                transitions[std::size_t(i) * states + j] = total > 0 ? p(i, j) / total : 1.0 / states;
+        }
+    }
+
+    double p(int from, int to) const { return transitions[std::size_t(from) * states + to]; }
+
+    // Stationary distribution by power iteration (rows are assumed normalised)
+    std::vector<double> stationary() const {
+        std::vector<double> pi(states, 1.0 / states), next(states);
+        for (int round = 0; round < 10000; round++) {
+            std::fill(next.begin(), next.end(), 0.0);
+            for (int i = 0; i < states; i++)
+                for (int j = 0; j < states; j++)
+                    next[j] += pi[i] * p(i, j);
+            // Averaging with the previous step also converges on periodic chains
+            double change = 0;
+            for (int j = 0; j < states; j++) {
+                next[j] = (next[j] + pi[j]) / 2;
+                change += std::abs(next[j] - pi[j]);
+            }
+            pi.swap(next);
+            if (change < 1e-12)
+                break;
+        }
+        return pi;
+    }
+
+    // H(outcome_t | outcome_t-1) in bits, in the stationary regime: what a predictor that
+    // knows only the previous outcome of this branch cannot remove
+    double conditional_entropy() const {
+        const auto pi = stationary();
+        double joint[2][2] = {}; // [previous taken][next taken]
+        for (int i = 0; i < states; i++)
+            for (int j = 0; j < states; j++)
+                joint[emits_taken(i)][emits_taken(j)] += pi[i] * p(i, j);
+        double h = 0;
+        for (const auto& row : joint) {
+            const double prev = row[0] + row[1];
+            if (prev > 0)
+                h += prev * binary_entropy(row[1] / prev);
+        }
+        return h;
+    }
+};
+
+// Walked from a stationary start; the state carries over between rows, so within a
+// row the correlation is exactly the chain's
+inline outcome_stream markov_outcomes(int size, int iter, const markov_chain& chain, std::uint64_t seed) {
+    auto engine = stream_engine(seed, pattern_stream_id);
+    auto draw = [&](const double* weights) {
+        double u = unit_random(engine);
+        for (int s = 0; s + 1 < chain.states; s++) {
+            if (u < weights[s]) return s;
+            u -= weights[s];
+        }
+        return chain.states - 1;
+    };
+    const auto pi = chain.stationary();
+    int state = draw(pi.data());
+    return outcome_stream(size, stream_rows(size, iter), [&] {
+        state = draw(&chain.transitions[std::size_t(state) * chain.states]);
+        return chain.emits_taken(state);
+    });
+}
+
+// One outcome stream up to outer iteration 'at' and another from there on: a phase change
+// in branch behaviour, for timing how long the predictor takes to re-learn
+class pattern_switch {
+public:
+    static constexpr const char* id    = "switch";
+    static constexpr const char* label = "Switch";
+
+    pattern_switch(outcome_stream before, outcome_stream after, int at)
+        : before_(std::move(before)), after_(std::move(after)), at_(at) {}
+
+    int operator()(int i, int j) const { return i < at_ ? before_(i, j) : after_(i, j); }
+
+    int at() const { return at_; }
+
+private:
+    outcome_stream before_;
+    outcome_stream after_;
+    int            at_;
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+// Hardware performance counters around a single kernel run.
+// Uses a perf_event_open group on Linux so that all events are scheduled together
+// and read atomically. On other platforms, or when the kernel denies access
+// (perf_event_paranoid, containers, VMs without a virtual PMU), the group is
+// simply unavailable and callers fall back to wall-clock time only. A group that
+// opens but never gets onto the PMU, e.g. because the NMI watchdog holds one of the
+// counters, is retried without the cache events before giving up.
+
+#include <optional>
+#include <cstdint>
+#include <array>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+enum class counter { cycles, instructions, branches, branch_misses, l1d_misses, llc_misses };
+
+constexpr int counter_count = 6;
+
+constexpr std::array<const char*, counter_count> counter_names = {
+    "Cycles", "Instructions", "Branches", "Branch Misses", "L1D Misses", "LLC Misses"
+};
+
+// Keys for the machine-readable results
+constexpr std::array<const char*, counter_count> counter_ids = {
+    "cycles", "instructions", "branches", "branch_misses", "l1d_misses", "llc_misses"
+};
+
+// One reading of the group; an event the host cannot count stays empty
+struct counter_values {
+    std::array<std::optional<std::uint64_t>, counter_count> values;
+
+    auto  operator[](counter c) const { return values[static_cast<int>(c)]; }
+    auto& operator[](counter c)       { return values[static_cast<int>(c)]; }
+
+    bool any() const {
+        for (const auto& v : values)
+            if (v) return true;
+        return false;
+    }
+};
+
+class perf_counters {
+public:
+    perf_counters() { open_all(); }
+
+    ~perf_counters() { close_all(); }
+
+    // Attaches a fresh group to the calling process; a fork()ed child needs this, since
+    // the descriptors it inherits still count the parent
+    void reopen() {
+        close_all();
+        open_all();
+    }
+
+    perf_counters(const perf_counters&)            = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    bool available() const { return !events_.empty(); }
+
+    void start() {
+#if defined(__linux__)
+        if (!available()) return;
+        ioctl(leader(), PERF_EVENT_IOC_RESET,  PERF_IOC_FLAG_GROUP);
+        ioctl(leader(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    void stop() {
+#if defined(__linux__)
+        if (!available()) return;
+        ioctl(leader(), PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    // Values are scaled by enabled/running time in case the group was multiplexed
+    counter_values read() const {
+        counter_values result;
+#if defined(__linux__)
+        if (!available()) return result;
+
+        // Layout of PERF_FORMAT_GROUP | TOTAL_TIME_ENABLED | TOTAL_TIME_RUNNING
+        std::vector<std::uint64_t> buffer(3 + events_.size());
+        const auto bytes = ::read(leader(), buffer.data(), buffer.size() * sizeof(std::uint64_t));
+        if (bytes < static_cast<ssize_t>(3 * sizeof(std::uint64_t)))
+            return result;
+
+        const auto nr      = buffer[0];
+        const auto enabled = buffer[1];
+        const auto running = buffer[2];
+        if (running == 0 || nr != events_.size())
+            return result; // the group never got onto the PMU
+
+        const double scale = static_cast<double>(enabled) / running;
+        for (std::size_t k = 0; k < events_.size(); ++k) {
+            result[events_[k].id] = static_cast<std::uint64_t>(buffer[3 + k] * scale);
+        }
+#endif
+        return result;
+    }
+
+private:
+    struct event {
+        counter id;
+        int     fd;
+    };
+
+    void open_all() {
+#if defined(__linux__)
+        for (bool with_caches : {true, false}) {
+            open(counter::cycles,        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+            open(counter::instructions,  PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+            open(counter::branches,      PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS);
+            open(counter::branch_misses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+            if (with_caches) {
+                open(counter::l1d_misses, PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D));
+                open(counter::llc_misses, PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_LL));
+            }
+            if (!available() || scheduled())
+                return;
+            close_all();
+        }
+#endif
+    }
+
+    void close_all() {
+#if defined(__linux__)
+        for (const auto& e : events_)
+            close(e.fd);
+#endif
+        events_.clear();
+    }
+
+#if defined(__linux__)
+    static constexpr std::uint64_t cache_event(std::uint64_t cache) {
+        return cache
+            | (PERF_COUNT_HW_CACHE_OP_READ     <<  8)
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+
+    int leader() const { return events_.front().fd; }
+
+    // One start/stop pair around a little work: did the group run at all?
+    bool scheduled() {
+        start();
+        volatile int spin = 0;
+        for (int k = 0; k < 1000; k++)
+            spin = spin + k;
+        stop();
+        std::vector<std::uint64_t> buffer(3 + events_.size());
+        const auto bytes = ::read(leader(), buffer.data(), buffer.size() * sizeof(std::uint64_t));
+        return bytes >= static_cast<ssize_t>(3 * sizeof(std::uint64_t)) && buffer[2] > 0;
+    }
+
+    void open(counter id, std::uint32_t type, std::uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size           = sizeof(attr);
+        attr.type           = type;
+        attr.config         = config;
+        attr.disabled       = events_.empty() ? 1 : 0; // only the leader gates the group
+        attr.exclude_kernel = 1;                       // allowed up to perf_event_paranoid=2
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_GROUP
+                            | PERF_FORMAT_TOTAL_TIME_ENABLED
+                            | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        const int group = events_.empty() ? -1 : leader();
+        const int fd    = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, PERF_FLAG_FD_CLOEXEC));
+        if (fd >= 0)
+            events_.push_back({id, fd});
+    }
+#endif
+
+    std::vector<event> events_;
+};
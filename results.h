@@ -0,0 +1,279 @@
+#pragma once
+
+// Structured results: every measured case as a record (id, parameters, samples,
+// statistics, counters) plus the run settings and the machine it ran on. The tables
+// are printed from these records, and --output serialises them to JSON or CSV.
+
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <deque>
+#include <cmath>
+#include <map>
+#include <format>
+#include "measurement.h"
+
+#if defined(_WIN32)
+#include <intrin.h>
+#endif
+
+// Injected by CMake; absent when built by hand
+#ifndef BPE_CXX_FLAGS
+#define BPE_CXX_FLAGS "unknown"
+#endif
+#ifndef BPE_BUILD_TYPE
+#define BPE_BUILD_TYPE "unknown"
+#endif
+
+// A parameter as text, and whether it came from a number. Only those are written as
+// JSON numbers: a label that happens to look numeric stays a string, and so does the
+// 64-bit seed, which JSON readers would otherwise round to a double.
+struct parameter_value {
+    std::string text;
+    bool        numeric = false;
+
+    parameter_value(std::string value)      : text(std::move(value)) {}
+    parameter_value(const char* value)      : text(value) {}
+    parameter_value(std::string_view value) : text(value) {}
+
+    template<class T> requires std::is_arithmetic_v<T> && (!std::is_same_v<T, bool>) && (!std::is_same_v<T, char>)
+    parameter_value(T value) : text(std::format("{}", value)), numeric(std::isfinite(static_cast<double>(value))) {}
+};
+
+using parameter_list = std::vector<std::pair<std::string, parameter_value>>;
+
+struct case_record {
+    std::string    id;         // e.g. "sorted/unpredictable/complex/branchy", "simd/sorted/avx2"
+    parameter_list parameters; // what the id encodes, plus size and iter
+    case_report    report;
+};
+
+struct machine_info {
+    std::string cpu;
+    std::string os;
+    std::string compiler;
+    std::string flags;
+    std::string build_type;
+    unsigned    threads = 0;
+
+    static machine_info detect() {
+        machine_info m;
+        m.cpu        = cpu_model();
+        m.os         = os_name();
+        m.compiler   = compiler_name();
+        m.flags      = BPE_CXX_FLAGS;
+        m.flags.erase(0, m.flags.find_first_not_of(' ')); // CMake joins the base and per-config flags with a space
+        m.build_type = BPE_BUILD_TYPE;
+        m.threads    = std::thread::hardware_concurrency();
+        return m;
+    }
+
+private:
+    static std::string cpu_model() {
+#if defined(__linux__)
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        for (std::string line; std::getline(cpuinfo, line); ) {
+            if (line.starts_with("model name")) {
+                const auto colon = line.find(':');
+                if (colon != std::string::npos)
+                    return line.substr(line.find_first_not_of(' ', colon + 1));
+            }
+        }
+#elif defined(_WIN32)
+        int regs[4];
+        __cpuid(regs, 0x80000000);
+        if (static_cast<unsigned>(regs[0]) >= 0x80000004) {
+            char brand[49] = {};
+            for (int leaf = 0; leaf < 3; leaf++) {
+                __cpuid(regs, 0x80000002 + leaf);
+                std::memcpy(brand + leaf * 16, regs, 16);
+            }
+            return std::string(brand).substr(std::string(brand).find_first_not_of(' '));
+        }
+#endif
+        return "unknown";
+    }
+
+    static std::string os_name() {
+#if defined(__linux__)
+        return "Linux";
+#elif defined(_WIN32)
+        return "Windows";
+#elif defined(__APPLE__)
+        return "macOS";
+#else
+        return "unknown";
+#endif
+    }
+
+    static std::string compiler_name() {
+#if defined(__clang__)
+        return "Clang " __clang_version__;
+#elif defined(__GNUC__)
+        return "GCC " __VERSION__;
+#elif defined(_MSC_VER)
+        return std::format("MSVC {}", _MSC_FULL_VER);
+#else
+        return "unknown";
+#endif
+    }
+};
+
+// All records of one run, in the order they were measured. References returned by
+// add() and find() stay valid for the lifetime of the set.
+class result_set {
+public:
+    machine_info   machine = machine_info::detect();
+    parameter_list settings; // run-wide options: mode, size, iter, seed, ...
+
+    const case_record& add(std::string id, parameter_list parameters, case_report report) {
+        index_[id] = records_.size();
+        records_.push_back({std::move(id), std::move(parameters), std::move(report)});
+        return records_.back();
+    }
+
+    const case_record* find(const std::string& id) const {
+        const auto it = index_.find(id);
+        return it == index_.end() ? nullptr : &records_[it->second];
+    }
+
+    const std::deque<case_record>& records() const { return records_; }
+
+private:
+    std::deque<case_record>            records_;
+    std::map<std::string, std::size_t> index_;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////// Serialisation
+
+inline std::string json_string(std::string_view text) {
+    std::string out = "\"";
+    for (char c : text) {
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n";  break;
+            case '\t': out += "\\t";  break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                    out += std::format("\\u{:04x}", static_cast<int>(c));
+                else
+                    out += c;
+        }
+    }
+    return out + "\"";
+}
+
+inline std::string json_value(const parameter_value& value) {
+    return value.numeric ? value.text : json_string(value.text);
+}
+
+inline std::string json_object(const parameter_list& fields) {
+    std::string out = "{";
+    for (std::size_t k = 0; k < fields.size(); k++)
+        out += std::format("{}{}: {}", k ? ", " : "", json_string(fields[k].first), json_value(fields[k].second));
+    return out + "}";
+}
+
+inline std::string to_json(const result_set& results) {
+    const auto& m = results.machine;
+    std::string out = "{\n";
+    out += "  \"machine\": " + json_object({{"cpu", m.cpu}, {"os", m.os}, {"threads", m.threads},
+        {"compiler", m.compiler}, {"flags", m.flags}, {"build_type", m.build_type}}) + ",\n";
+    out += "  \"settings\": " + json_object(results.settings) + ",\n";
+    out += "  \"cases\": [";
+    bool first = true;
+    for (const auto& r : results.records()) {
+        const auto& t = r.report.time;
+        out += first ? "\n" : ",\n";
+        first = false;
+        out += "    {\"id\": " + json_string(r.id) + ", \"parameters\": " + json_object(r.parameters) + ",\n";
+        out += std::format("     \"time\": {{\"count\": {}, \"rejected\": {}, \"min\": {}, \"median\": {}, \"mad\": {}, \"ci_low\": {}, \"ci_high\": {}}},\n",
+            t.count, t.rejected, t.min, t.median, t.mad, t.ci_low, t.ci_high);
+        out += "     \"samples\": [";
+        for (std::size_t k = 0; k < t.samples.size(); k++)
+            out += std::format("{}{}", k ? ", " : "", t.samples[k]);
+        const auto& w = r.report.warmup;
+        out += std::format("],\n     \"warmup\": {{\"runs\": {}, \"seconds\": {}, \"spread\": {}, \"converged\": {}}},\n",
+            w.runs, w.seconds, w.spread, w.converged ? "true" : "false");
+        const auto& l = r.report.latency;
+        if (l.count > 0)
+            out += std::format("     \"latency_ns\": {{\"batches\": {}, \"p50\": {}, \"p90\": {}, \"p99\": {}, \"p99.9\": {}, \"max\": {}}},\n",
+                l.count, l.p50, l.p90, l.p99, l.p999, l.max);
+        else
+            out += "     \"latency_ns\": null,\n";
+        out += std::format("     \"tsc_cycles\": {},\n     \"counters\": {{", r.report.cycles);
+        for (int k = 0; k < counter_count; k++) {
+            const auto& v = r.report.counters.values[k];
+            out += std::format("{}\"{}\": {}", k ? ", " : "", counter_ids[k], v ? std::to_string(*v) : "null");
+        }
+        out += "}}";
+    }
+    out += "\n  ]\n}\n";
+    return out;
+}
+
+inline std::string csv_field(std::string_view text) {
+    if (text.find_first_of(",\"\n") == std::string_view::npos)
+        return std::string(text);
+    std::string out = "\"";
+    for (char c : text)
+        out += c == '"' ? std::string("\"\"") : std::string(1, c);
+    return out + "\"";
+}
+
+// One row per case; the machine and the settings go first as '#' comment lines.
+// Parameters are "key=value" pairs and samples are joined by ';' within one field.
+inline std::string to_csv(const result_set& results) {
+    const auto& m = results.machine;
+    std::string out = std::format("# cpu: {}\n# os: {}\n# threads: {}\n# compiler: {}\n# flags: {}\n# build_type: {}\n",
+        m.cpu, m.os, m.threads, m.compiler, m.flags, m.build_type);
+    for (const auto& [key, value] : results.settings)
+        out += std::format("# {}: {}\n", key, value.text);
+
+    out += "id,parameters,count,rejected,min,median,mad,ci_low,ci_high,warmup_runs,warmup_spread,warmup_converged,"
+           "latency_batches,latency_p50_ns,latency_p90_ns,latency_p99_ns,latency_p999_ns,latency_max_ns,tsc_cycles";
+    for (const auto* id : counter_ids)
+        out += std::format(",{}", id);
+    out += ",samples\n";
+
+    for (const auto& r : results.records()) {
+        const auto& t = r.report.time;
+        std::string parameters, samples;
+        for (const auto& [key, value] : r.parameters)
+            parameters += std::format("{}{}={}", parameters.empty() ? "" : ";", key, value.text);
+        for (double x : t.samples)
+            samples += std::format("{}{}", samples.empty() ? "" : ";", x);
+
+        const auto& w = r.report.warmup;
+        const auto& l = r.report.latency;
+        out += std::format("{},{},{},{},{},{},{},{},{},{},{},{},", csv_field(r.id), csv_field(parameters),
+            t.count, t.rejected, t.min, t.median, t.mad, t.ci_low, t.ci_high, w.runs, w.spread, w.converged ? 1 : 0);
+        out += l.count > 0 ? std::format("{},{},{},{},{},{},", l.count, l.p50, l.p90, l.p99, l.p999, l.max) : std::string(",,,,,,");
+        out += std::format("{}", r.report.cycles);
+        for (const auto& v : r.report.counters.values)
+            out += v ? std::format(",{}", *v) : std::string(",");
+        out += "," + csv_field(samples) + "\n";
+    }
+    return out;
+}
+
+// 'format' is "json" or "csv"; returns false if the format is unknown or the file cannot be written
+inline bool write_results(const result_set& results, std::string_view format, const std::string& path) {
+    std::string text;
+    if (format == "json")
+        text = to_json(results);
+    else if (format == "csv")
+        text = to_csv(results);
+    else
+        return false;
+    std::ofstream file(path, std::ios::binary);
+    file << text;
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+// Interleaved case scheduling. Instead of taking every sample of one case before moving
+// on, each round visits every unfinished case once, in an order shuffled from the run
+// seed (A B C D, then D B A C, ...). Frequency ramps, thermal drift and the state left
+// behind by the previous case then spread over all cases instead of biasing the ones
+// that happen to run first, and the recorded order lets drift be measured.
+
+#include <functional>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+#include <span>
+#include "measurement.h"
+#include "dataset.h"
+
+// Engine stream of the run seed reserved for the schedule
+constexpr std::uint64_t schedule_stream_id = ~std::uint64_t(3);
+
+struct schedule_log {
+    std::vector<std::vector<std::size_t>> rounds; // case indices in visiting order, per round
+    std::vector<std::vector<std::size_t>> slots;  // per case: position of each of its samples in the whole run
+    double drift = 0; // least-squares change of time per round, relative to each case's median,
+                      // over the rounds that visited every case
+};
+
+// Measures every run in interleaved rounds; the reports come back in the order of 'runs'
+inline std::vector<case_report> measure_interleaved(std::span<const std::function<case_result()>> runs, const repetition_policy& policy,
+                                                    std::uint64_t seed, schedule_log& log) {
+    std::vector<case_sampler<const std::function<case_result()>&>> samplers;
+    samplers.reserve(runs.size());
+    for (const auto& run : runs)
+        samplers.emplace_back(run, policy);
+
+    auto engine = stream_engine(seed, schedule_stream_id);
+    std::vector<std::size_t> order(runs.size());
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    std::vector<std::vector<std::pair<std::size_t, double>>> timeline(runs.size()); // (round, seconds) per case
+    log = {};
+    log.slots.resize(runs.size());
+
+    std::size_t slot = 0;
+    while (true) {
+        shuffle(order, engine);
+        std::vector<std::size_t> visited;
+        for (auto k : order) {
+            if (samplers[k].done())
+                continue;
+            const double seconds = samplers[k].sample();
+            timeline[k].push_back({log.rounds.size(), seconds});
+            log.slots[k].push_back(slot++);
+            visited.push_back(k);
+        }
+        if (visited.empty())
+            break;
+        log.rounds.push_back(std::move(visited));
+    }
+
+    std::vector<case_report> reports;
+    double sxy = 0, sxx = 0, sx = 0, sy = 0, n = 0;
+    for (std::size_t k = 0; k < samplers.size(); k++) {
+        reports.push_back(samplers[k].report());
+        const double median = reports.back().time.median;
+        if (median <= 0)
+            continue;
+        for (const auto& [round, seconds] : timeline[k]) {
+            if (log.rounds[round].size() != runs.size())
+                continue; // later rounds only revisit the noisy cases
+            const double x = static_cast<double>(round), y = seconds / median - 1;
+            sx += x; sy += y; sxx += x * x; sxy += x * y; n++;
+        }
+    }
+    const double denominator = n * sxx - sx * sx;
+    log.drift = denominator > 0 ? (n * sxy - sx * sy) / denominator : 0;
+    return reports;
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+// Vectorised predicate-sum: sum of (threshold > x ? x : pivot) over an int array,
+// i.e. the predictable kernel with the branch replaced by compare masks and a
+// masked add. One implementation per instruction set; the ones the running CPU
+// supports are found through CPUID, so the binary itself needs no -m flags.
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BPE_X86_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define BPE_X86_SIMD 0
+#endif
+
+#if BPE_X86_SIMD && (defined(__GNUC__) || defined(__clang__))
+#define BPE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define BPE_TARGET(isa)
+#endif
+
+// Keeps the scalar reference scalar: left alone, -O2 auto-vectorises it (GCC 12 and up)
+#if defined(__clang__)
+#define BPE_SCALAR_FUNCTION
+#define BPE_SCALAR_LOOP _Pragma("clang loop vectorize(disable) interleave(disable)")
+#elif defined(__GNUC__)
+#define BPE_SCALAR_FUNCTION __attribute__((optimize("no-tree-vectorize")))
+#define BPE_SCALAR_LOOP
+#elif defined(_MSC_VER)
+#define BPE_SCALAR_FUNCTION
+#define BPE_SCALAR_LOOP __pragma(loop(no_vector))
+#else
+#define BPE_SCALAR_FUNCTION
+#define BPE_SCALAR_LOOP
+#endif
+
+enum class simd_isa { scalar, sse42, avx2, avx512 };
+
+constexpr std::array<simd_isa, 4> simd_isas = {simd_isa::scalar, simd_isa::sse42, simd_isa::avx2, simd_isa::avx512};
+
+inline const char* isa_name(simd_isa isa) {
+    switch (isa) {
+        case simd_isa::scalar: return "Scalar";
+        case simd_isa::sse42:  return "SSE4.2";
+        case simd_isa::avx2:   return "AVX2";
+        case simd_isa::avx512: return "AVX-512";
+    }
+    return "?";
+}
+
+// Lower-case key for the machine-readable results
+inline const char* isa_id(simd_isa isa) {
+    switch (isa) {
+        case simd_isa::scalar: return "scalar";
+        case simd_isa::sse42:  return "sse42";
+        case simd_isa::avx2:   return "avx2";
+        case simd_isa::avx512: return "avx512";
+    }
+    return "?";
+}
+
+inline bool isa_supported(simd_isa isa) {
+#if BPE_X86_SIMD && (defined(__GNUC__) || defined(__clang__))
+    switch (isa) {
+        case simd_isa::scalar: return true;
+        case simd_isa::sse42:  return __builtin_cpu_supports("sse4.2");
+        case simd_isa::avx2:   return __builtin_cpu_supports("avx2");
+        case simd_isa::avx512: return __builtin_cpu_supports("avx512f");
+    }
+    return false;
+#elif BPE_X86_SIMD && defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    const int max_leaf = regs[0];
+    __cpuid(regs, 1);
+    const bool sse42   = (regs[2] >> 20) & 1;
+    const bool osxsave = (regs[2] >> 27) & 1;
+    // The OS must save the YMM (and for AVX-512 the ZMM/opmask) state on context switches
+    const auto xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool avx2 = false, avx512 = false;
+    if (max_leaf >= 7) {
+        __cpuidex(regs, 7, 0);
+        avx2   = ((regs[1] >>  5) & 1) && (xcr0 & 0x06) == 0x06;
+        avx512 = ((regs[1] >> 16) & 1) && (xcr0 & 0xe6) == 0xe6;
+    }
+    switch (isa) {
+        case simd_isa::scalar: return true;
+        case simd_isa::sse42:  return sse42;
+        case simd_isa::avx2:   return avx2;
+        case simd_isa::avx512: return avx512;
+    }
+    return false;
+#else
+    return isa == simd_isa::scalar;
+#endif
+}
+
+BPE_SCALAR_FUNCTION
+inline std::int64_t predicate_sum_scalar(const int* data, std::size_t n, int threshold, int pivot) {
+    std::int64_t sum = 0;
+    BPE_SCALAR_LOOP
+    for (std::size_t j = 0; j < n; j++)
+        sum += threshold > data[j] ? data[j] : pivot;
+    return sum;
+}
+
+#if BPE_X86_SIMD
+BPE_TARGET("sse4.2")
+inline std::int64_t predicate_sum_sse42(const int* data, std::size_t n, int threshold, int pivot) {
+    const __m128i t = _mm_set1_epi32(threshold);
+    const __m128i p = _mm_set1_epi32(pivot);
+    __m128i acc = _mm_setzero_si128();
+    std::size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        const __m128i x    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + j));
+        const __m128i take = _mm_cmpgt_epi32(t, x);
+        const __m128i v    = _mm_blendv_epi8(p, x, take);
+        acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(v));
+        acc = _mm_add_epi64(acc, _mm_cvtepi32_epi64(_mm_srli_si128(v, 8)));
+    }
+    alignas(16) std::int64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    return lanes[0] + lanes[1] + predicate_sum_scalar(data + j, n - j, threshold, pivot);
+}
+
+BPE_TARGET("avx2")
+inline std::int64_t predicate_sum_avx2(const int* data, std::size_t n, int threshold, int pivot) {
+    const __m256i t = _mm256_set1_epi32(threshold);
+    const __m256i p = _mm256_set1_epi32(pivot);
+    __m256i acc = _mm256_setzero_si256();
+    std::size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        const __m256i x    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + j));
+        const __m256i take = _mm256_cmpgt_epi32(t, x);
+        const __m256i v    = _mm256_blendv_epi8(p, x, take);
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+    alignas(32) std::int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + predicate_sum_scalar(data + j, n - j, threshold, pivot);
+}
+
+// GCC 12 flags the _mm512_undefined_* placeholders inside its own intrinsic headers
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+BPE_TARGET("avx512f")
+inline std::int64_t predicate_sum_avx512(const int* data, std::size_t n, int threshold, int pivot) {
+    const __m512i t = _mm512_set1_epi32(threshold);
+    const __m512i p = _mm512_set1_epi32(pivot);
+    __m512i acc = _mm512_setzero_si512();
+    std::size_t j = 0;
+    for (; j + 16 <= n; j += 16) {
+        const __m512i   x    = _mm512_loadu_si512(data + j);
+        const __mmask16 take = _mm512_cmpgt_epi32_mask(t, x);
+        const __m512i   v    = _mm512_mask_blend_epi32(take, p, x);
+        acc = _mm512_add_epi64(acc, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(v)));
+        acc = _mm512_add_epi64(acc, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(v, 1)));
+    }
+    return _mm512_reduce_add_epi64(acc) + predicate_sum_scalar(data + j, n - j, threshold, pivot);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+// Callers check isa_supported() first; an unsupported ISA falls back to scalar
+inline std::int64_t predicate_sum(simd_isa isa, const int* data, std::size_t n, int threshold, int pivot) {
+    switch (isa) {
+#if BPE_X86_SIMD
+        case simd_isa::sse42:  return predicate_sum_sse42 (data, n, threshold, pivot);
+        case simd_isa::avx2:   return predicate_sum_avx2  (data, n, threshold, pivot);
+        case simd_isa::avx512: return predicate_sum_avx512(data, n, threshold, pivot);
+#endif
+        default:               return predicate_sum_scalar(data, n, threshold, pivot);
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+// The ways the sorted cases can get their data sorted. The sort happens once, when
+// the registry prepares the sorted dataset, and is timed separately from the scans
+// so that "sort first, then scan" can be weighed against scanning unsorted data.
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include <array>
+
+#if __has_include(<execution>)
+#include <execution>
+#endif
+
+enum class sort_algorithm { std_sort, par_unseq, radix, counting };
+
+constexpr std::array<sort_algorithm, 4> sort_algorithms = {
+    sort_algorithm::std_sort, sort_algorithm::par_unseq, sort_algorithm::radix, sort_algorithm::counting
+};
+
+inline const char* sort_name(sort_algorithm algorithm) {
+    switch (algorithm) {
+        case sort_algorithm::std_sort:  return "std::sort";
+        case sort_algorithm::par_unseq: return "std::sort par_unseq";
+        case sort_algorithm::radix:     return "LSD radix";
+        case sort_algorithm::counting:  return "Counting";
+    }
+    return "?";
+}
+
+// Command-line spelling, also the key in the machine-readable results
+constexpr std::array<const char*, 4> sort_ids = {"std", "par", "radix", "counting"};
+
+inline const char* sort_id(sort_algorithm algorithm) { return sort_ids[static_cast<int>(algorithm)]; }
+
+inline bool parse_sort_algorithm(std::string_view text, sort_algorithm& algorithm) {
+    for (std::size_t k = 0; k < sort_ids.size(); k++) {
+        if (text == sort_ids[k]) {
+            algorithm = sort_algorithms[k];
+            return true;
+        }
+    }
+    return false;
+}
+
+// Four 8-bit passes over the value with its sign bit flipped, so that negative
+// numbers order before positive ones as unsigned keys
+inline void radix_sort(std::vector<int>& numbers) {
+    std::vector<int> buffer(numbers.size());
+    for (int shift = 0; shift < 32; shift += 8) {
+        std::array<std::size_t, 257> offsets = {};
+        for (int x : numbers)
+            offsets[((static_cast<std::uint32_t>(x) ^ 0x80000000u) >> shift & 0xff) + 1]++;
+        for (int b = 0; b < 256; b++)
+            offsets[b + 1] += offsets[b];
+        for (int x : numbers)
+            buffer[offsets[(static_cast<std::uint32_t>(x) ^ 0x80000000u) >> shift & 0xff]++] = x;
+        numbers.swap(buffer);
+    }
+}
+
+// One counter per distinct value between min and max: linear when the range is on the
+// order of the size, as it is here ([-2 size, 2 size]). Wider ranges go to radix_sort.
+inline void counting_sort(std::vector<int>& numbers) {
+    if (numbers.empty()) return;
+    const auto [lo, hi] = std::minmax_element(numbers.begin(), numbers.end());
+    const int min = *lo;
+    const auto range = static_cast<std::size_t>(static_cast<std::int64_t>(*hi) - min) + 1;
+    if (range > 8 * numbers.size() + 1024) {
+        radix_sort(numbers);
+        return;
+    }
+    std::vector<std::size_t> counts(range);
+    for (int x : numbers)
+        counts[static_cast<std::size_t>(static_cast<std::int64_t>(x) - min)]++;
+    auto out = numbers.begin();
+    for (std::size_t v = 0; v < counts.size(); v++)
+        out = std::fill_n(out, counts[v], static_cast<int>(min + static_cast<std::int64_t>(v)));
+}
+
+// Without a parallel standard library par_unseq falls back to std::sort
+inline void sort_numbers(std::vector<int>& numbers, sort_algorithm algorithm) {
+    switch (algorithm) {
+        case sort_algorithm::par_unseq:
+#if defined(__cpp_lib_parallel_algorithm)
+            std::sort(std::execution::par_unseq, numbers.begin(), numbers.end());
+            return;
+#else
+            break;
+#endif
+        case sort_algorithm::radix:    radix_sort(numbers);    return;
+        case sort_algorithm::counting: counting_sort(numbers); return;
+        case sort_algorithm::std_sort: break;
+    }
+    std::sort(numbers.begin(), numbers.end());
+}
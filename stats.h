@@ -0,0 +1,259 @@
+#pragma once
+
+// Repetition and robust statistics on top of zen::timer / zen::measure_execution.
+// A case is sampled until a minimum count is reached and, optionally, until the
+// 95% confidence interval of its median is tight enough. Samples taken while the
+// thread was preempted, and upper-tail outliers, are dropped before summarising.
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <cmath>
+#include "kaizen.h"
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+struct repetition_policy {
+    int    min_reps      = 5;
+    int    max_reps      = 50;
+    double target_rel_ci = 0;   // relative half-width of the 95% CI; 0 = stop at min_reps
+    double outlier_z     = 3.5; // modified z-score above which a sample is rejected
+
+    // Warm-up before the first sample: runs until the last 'warmup_window' timings agree
+    // within 'warmup_tolerance' (relative), for at least 'warmup_min' and at most
+    // 'warmup_cap' seconds. A tolerance of 0 skips the warm-up.
+    double warmup_tolerance = 0.02;
+    int    warmup_window    = 3;
+    double warmup_min       = 0.01;
+    double warmup_cap       = 0.5;
+};
+
+// How the warm-up of one case ended
+struct warmup_summary {
+    int    runs      = 0;
+    double seconds   = 0;     // time spent in the warm-up runs
+    double spread    = 0;     // (max - min) / min of the last window of runs
+    bool   converged = false; // false: stopped by the cap (or skipped)
+};
+
+struct sample_summary {
+    int    count    = 0; // samples kept
+    int    rejected = 0; // preempted or outlying samples dropped
+    double min      = 0;
+    double median   = 0;
+    double mad      = 0; // median absolute deviation (unscaled)
+    double ci_low   = 0; // 95% confidence interval of the median
+    double ci_high  = 0;
+    std::vector<double> samples; // the kept samples, ascending
+
+    double rel_ci() const { return median > 0 ? (ci_high - ci_low) / 2 / median : 0; }
+};
+
+inline double median_of(std::vector<double> v) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    const auto n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+// Distribution-free CI of the median from order statistics (normal approximation
+// to the binomial); with fewer than six samples it degrades to [min, max].
+inline sample_summary summarize(std::vector<double> samples, int rejected = 0) {
+    sample_summary s;
+    s.rejected = rejected;
+    if (samples.empty()) return s;
+
+    std::sort(samples.begin(), samples.end());
+    const int n = static_cast<int>(samples.size());
+    s.count  = n;
+    s.min    = samples.front();
+    s.median = median_of(samples);
+
+    std::vector<double> deviations;
+    for (double x : samples) deviations.push_back(std::abs(x - s.median));
+    s.mad = median_of(deviations);
+
+    const double half = 1.96 * std::sqrt(n) / 2;
+    const int lo = std::max(0,     static_cast<int>(std::floor(n / 2.0 - half)));
+    const int hi = std::min(n - 1, static_cast<int>(std::ceil (n / 2.0 + half)) - 1);
+    s.ci_low  = samples[lo];
+    s.ci_high = samples[std::max(lo, hi)];
+    s.samples = std::move(samples);
+    return s;
+}
+
+// Drops the upper-tail outliers (modified z-score on the MAD), keeping at least three samples
+inline int reject_outliers(std::vector<double>& samples, double z) {
+    if (samples.size() <= 3) return 0;
+    const double med = median_of(samples);
+    std::vector<double> deviations;
+    for (double x : samples) deviations.push_back(std::abs(x - med));
+    const double mad = median_of(deviations);
+    if (mad == 0) return 0;
+
+    std::vector<double> kept;
+    for (double x : samples)
+        if (0.6745 * (x - med) / mad <= z)
+            kept.push_back(x);
+    if (kept.size() < 3) return 0;
+
+    const int dropped = static_cast<int>(samples.size() - kept.size());
+    samples = std::move(kept);
+    return dropped;
+}
+
+// Involuntary context switches of the calling thread; a change across a sample means
+// the scheduler took the core away while it was being timed
+inline long involuntary_switches() {
+#if defined(__linux__) && defined(RUSAGE_THREAD)
+    rusage usage{};
+    if (getrusage(RUSAGE_THREAD, &usage) == 0)
+        return usage.ru_nivcsw;
+#endif
+    return 0;
+}
+
+// Two cases differ significantly when the confidence intervals of their medians do not overlap
+inline bool significantly_different(const sample_summary& a, const sample_summary& b) {
+    return a.ci_high < b.ci_low || b.ci_high < a.ci_low;
+}
+
+// Two-sided 95% quantile of Student's t with 'df' degrees of freedom
+inline double student_t95(int df) {
+    static constexpr double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                       2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                       2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (df < 1) return 0;
+    if (df <= 30) return table[df - 1];
+    return 1.96 + 2.4 / df; // within 0.3% from 30 degrees of freedom up
+}
+
+// Ordinary least squares y = intercept + slope * x, with the 95% CI of the slope
+struct line_fit {
+    double slope      = 0;
+    double intercept  = 0;
+    double slope_low  = 0;
+    double slope_high = 0;
+    double r2         = 0;
+    int    points     = 0;
+};
+
+inline line_fit fit_line(const std::vector<double>& x, const std::vector<double>& y) {
+    line_fit fit;
+    const std::size_t n = std::min(x.size(), y.size());
+    fit.points = static_cast<int>(n);
+    if (n < 2) return fit;
+
+    double mx = 0, my = 0;
+    for (std::size_t k = 0; k < n; k++) { mx += x[k]; my += y[k]; }
+    mx /= n;
+    my /= n;
+    double sxx = 0, sxy = 0, syy = 0;
+    for (std::size_t k = 0; k < n; k++) {
+        sxx += (x[k] - mx) * (x[k] - mx);
+        sxy += (x[k] - mx) * (y[k] - my);
+        syy += (y[k] - my) * (y[k] - my);
+    }
+    if (sxx == 0) return fit;
+
+    fit.slope     = sxy / sxx;
+    fit.intercept = my - fit.slope * mx;
+    const double sse = std::max(0.0, syy - fit.slope * sxy);
+    fit.r2 = syy > 0 ? 1 - sse / syy : 1;
+    const double half = n > 2 ? student_t95(static_cast<int>(n) - 2) * std::sqrt(sse / (n - 2) / sxx) : 0;
+    fit.slope_low  = fit.slope - half;
+    fit.slope_high = fit.slope + half;
+    return fit;
+}
+
+// Calls 'sample' (returning seconds) until consecutive timings settle: the core has left
+// its idle P-state, turbo has stabilised and the caches and predictor hold this kernel.
+// Runs of the kernel about to be measured, so whatever ran before it no longer matters.
+template<class Sample>
+warmup_summary warm_up_samples(Sample&& sample, const repetition_policy& policy) {
+    warmup_summary w;
+    if (policy.warmup_tolerance <= 0)
+        return w;
+    const std::size_t window = std::max(2, policy.warmup_window);
+    std::vector<double> recent;
+    while (true) {
+        const double seconds = sample();
+        w.runs++;
+        w.seconds += seconds;
+        recent.push_back(seconds);
+        if (recent.size() > window)
+            recent.erase(recent.begin());
+
+        if (recent.size() == window) {
+            const auto [lo, hi] = std::minmax_element(recent.begin(), recent.end());
+            w.spread = *lo > 0 ? (*hi - *lo) / *lo : 0;
+            if (w.spread <= policy.warmup_tolerance && w.seconds >= policy.warmup_min) {
+                w.converged = true;
+                break;
+            }
+        }
+        if (w.seconds >= policy.warmup_cap)
+            break;
+    }
+    return w;
+}
+
+// The samples of one case as they come in. repeat_samples() takes them in a row; an
+// interleaved schedule takes one per case per round until every case is done().
+class sample_collector {
+public:
+    explicit sample_collector(const repetition_policy& policy)
+        : policy_(policy), limit_(std::max(policy.min_reps, policy.max_reps)) {}
+
+    // One call of 'sample' (returning seconds); preempted samples are dropped unless it is the last one allowed
+    template<class Sample>
+    double take(Sample&& sample) {
+        const long switches = involuntary_switches();
+        const double seconds = sample();
+        if (involuntary_switches() != switches && taken_ + 1 < limit_)
+            preempted_++;
+        else
+            samples_.push_back(seconds);
+        taken_++;
+        return seconds;
+    }
+
+    bool done() const {
+        if (taken_ >= limit_)
+            return true;
+        if (static_cast<int>(samples_.size()) < policy_.min_reps)
+            return false;
+        return policy_.target_rel_ci <= 0 || summarize(samples_).rel_ci() <= policy_.target_rel_ci;
+    }
+
+    sample_summary summary() const {
+        auto samples = samples_;
+        const int outliers = reject_outliers(samples, policy_.outlier_z);
+        return summarize(std::move(samples), preempted_ + outliers);
+    }
+
+private:
+    repetition_policy   policy_;
+    int                 limit_;
+    int                 taken_     = 0;
+    int                 preempted_ = 0;
+    std::vector<double> samples_;
+};
+
+// Calls 'sample' (returning seconds) until the policy is satisfied and summarises the kept samples
+template<class Sample>
+sample_summary repeat_samples(Sample&& sample, const repetition_policy& policy) {
+    sample_collector collector(policy);
+    while (!collector.done())
+        collector.take(sample);
+    return collector.summary();
+}
+
+// Convenience for plain callables, timed with zen::measure_execution
+inline sample_summary repeat_execution(std::function<void()> operation, const repetition_policy& policy) {
+    return repeat_samples([&] {
+        return zen::measure_execution<zen::timer::nsec>(operation).count() / 1e9;
+    }, policy);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+// Working-set sweep: data sizes chosen around the cache hierarchy of the host, so
+// that one run shows where the branch effects dominate and where memory does.
+// Cache sizes come from sysfs on Linux; elsewhere, or if sysfs is unreadable,
+// typical desktop sizes are assumed.
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <format>
+
+struct cache_level {
+    int         level = 0;
+    std::string type;      // "Data", "Unified" or "Instruction"
+    std::size_t bytes = 0;
+};
+
+// "48K" / "2048K" / "32M" as found in sysfs
+inline std::size_t parse_cache_size(const std::string& text) {
+    std::size_t pos = 0;
+    const auto value = std::stoull(text, &pos);
+    const char unit = pos < text.size() ? text[pos] : ' ';
+    if (unit == 'K') return value << 10;
+    if (unit == 'M') return value << 20;
+    if (unit == 'G') return value << 30;
+    return value;
+}
+
+// Data and unified caches seen by cpu0, innermost first. cpu0 stands in for the rest:
+// the benchmark is single-threaded and hybrid cores share the LLC anyway.
+inline std::vector<cache_level> detect_caches() {
+    std::vector<cache_level> caches;
+#if defined(__linux__)
+    for (int index = 0; ; index++) {
+        const std::string dir = std::format("/sys/devices/system/cpu/cpu0/cache/index{}/", index);
+        std::ifstream level_file(dir + "level"), type_file(dir + "type"), size_file(dir + "size");
+        if (!level_file || !type_file || !size_file)
+            break;
+        cache_level c;
+        std::string size;
+        level_file >> c.level;
+        type_file  >> c.type;
+        size_file  >> size;
+        if (c.type == "Instruction" || size.empty())
+            continue;
+        c.bytes = parse_cache_size(size);
+        caches.push_back(c);
+    }
+    std::sort(caches.begin(), caches.end(), [](const auto& a, const auto& b) { return a.level < b.level; });
+#endif
+    if (caches.empty())
+        caches = {{1, "Data", 32 << 10}, {2, "Unified", 1 << 20}, {3, "Unified", 32 << 20}};
+    return caches;
+}
+
+struct sweep_point {
+    std::string name;     // "L1", "L2", ..., "DRAM"
+    int         elements;
+};
+
+// Half of each level (fits with room to spare for the stack; the thresholds are drawn
+// inline, since a pregenerated stream would add its own 4 MiB), then twice the last
+// level, which no cache can hold
+inline std::vector<sweep_point> sweep_points(const std::vector<cache_level>& caches) {
+    std::vector<sweep_point> points;
+    for (const auto& c : caches)
+        points.push_back({std::format("L{}", c.level), static_cast<int>(c.bytes / 2 / sizeof(int))});
+    points.push_back({"DRAM", static_cast<int>(caches.back().bytes * 2 / sizeof(int))});
+    return points;
+}